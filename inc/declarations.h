@@ -86,13 +86,54 @@
 #define INOTIFY_IX2 3
 #define INFO_IX 4
 #define SIGNAL_IX 5
+#define LOADER_IX 6
+#define REFRESH_IX 7
+#define PREFETCH_IX 8
+#define JOBS_IX 9
 #if ARCHIVE_VERSION_NUMBER >= 3002000
-#define ARCHIVE_IX 6
-#define DEVMON_IX 7
+#define ARCHIVE_IX 10
+#define DEVMON_IX 11
 #else
-#define DEVMON_IX 6
+#define DEVMON_IX 10
 #endif
 
+/*
+ * dir_job states: a stamped job opened its dir (taking its stamp) and watches it.
+ * LOAD_FAILED is only returned by take_listing, for a dir that could not be opened.
+ */
+#define LOAD_RUNNING 0
+#define LOAD_STAMPED 1
+#define LOAD_PARTIAL 2
+#define LOAD_DONE 3
+#define LOAD_ABANDONED 4
+#define LOAD_FAILED 5
+
+/*
+ * inotify events watched on tabs' dirs
+ */
+#define INOTIFY_MASK (IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVE)
+
+/*
+ * Max ms UI waits for a stat (eg: of the file under cursor) before giving up
+ */
+#define ENTER_STAT_TIMEOUT 1000
+
+/*
+ * Pending updates of a tab, drawn by next refresh pass:
+ * rows from dirty_row, or just total size.
+ * DIRTY_FILTER: list changed while in filter mode, it needs to be filtered again.
+ */
+#define DIRTY_ROWS 1
+#define DIRTY_TOTAL 2
+#define DIRTY_FILTER 4
+
+/*
+ * file_entry stat status
+ */
+#define STAT_MISSING 0
+#define STAT_CACHED 1
+#define STAT_FAILED 2
+
 /*
  * Useful macro to know number of elements in arrays
  */
@@ -120,11 +161,17 @@ struct conf {
 #endif
     wchar_t cursor_chars[3];
     char sysinfo_layout[4];
+    int loading_timeout;
+    int refresh_delay;
+    int dir_cache_size;
+    int jobs_per_device;
 };
 
 /*
  * for each tab: an fd to catch inotify events,
  * and a wd, that uniquely represents an inotify watch.
+ * Each listing gets its own inotify instance (set up by its dir_job),
+ * watching only its dir: fd is -1 while tab watches nothing.
  */
 struct inotify {
     int fd;
@@ -132,7 +179,69 @@ struct inotify {
 };
 
 /*
- * Struct that holds UI informations per-tab
+ * Single entry of a file_list: its name is stored
+ * inside the list's arena, name_off bytes from its start.
+ * ino comes from dirent (or from stat).
+ * hidden is set for dotfiles, selected if its fullpath is among selected files.
+ * size, mtime and mode are cached (lstat) data,
+ * valid only if stat_state == STAT_CACHED.
+ */
+struct file_entry {
+    size_t name_off;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    mode_t mode;
+    unsigned short name_len;
+    unsigned char d_type;
+    unsigned char stat_state;
+    unsigned char hidden;
+    unsigned char selected;
+};
+
+/*
+ * Compact list of files: every name is stored (NUL terminated)
+ * inside a single contiguous arena, and all of them share "prefix" path.
+ * prefix is empty for lists of fullpaths (eg: bookmarks or selected files).
+ * holes: bytes of arena used by already removed entries.
+ * Entries from num to num + num_hidden are filtered out dotfiles:
+ * they are not listed, but kept to be shown again without rescanning the dir.
+ * name_index: listed entries' indexes sorted by name (strcmp), for prefix lookups;
+ * built on first lookup, kept up to date when entries are added, removed or merged,
+ * dropped only when the whole list is sorted or filtered again. It has room for size indexes.
+ * hash: name -> entry index hash table (open addressing, -1 for empty slots, hash_size a power of 2),
+ * built on first find_in_list, kept up to date by add_to_list and dropped when entries move.
+ */
+struct file_list {
+    char prefix[PATH_MAX + 1];
+    size_t prefix_len;
+    char *arena;
+    size_t arena_len, arena_size, holes;
+    struct file_entry *entries;
+    int num, num_hidden, size;
+    int *name_index;
+    int *hash, hash_size;
+};
+
+/*
+ * What is currently drawn in a visible row of a tab:
+ * selection mark, name (already cut to tab's width) and its attributes,
+ * size (or device info) string with its column, and permissions string.
+ * valid is 0 if row content is not known (eg: after window was erased).
+ */
+struct row_cache {
+    int valid;
+    int selected;
+    attr_t color;
+    int stat_col;
+    char name[PATH_MAX + 1];
+    char stat[100];
+    char perm[10];
+};
+
+/*
+ * Struct that holds UI informations per-tab.
+ * rows: cache of its num_rows visible rows.
  */
 struct scrstr {
     WINDOW *fm;
@@ -140,17 +249,76 @@ struct scrstr {
     int delta;
     int stat_active;
     char tot_size[30];
+    off_t tot_bytes;
+    int dirty;
+    int dirty_row;
+    struct row_cache *rows;
+    int num_rows;
 };
 
-enum working_mode {normal, fast_browse_, bookmarks_, search_, device_, selected_};
+enum working_mode {normal, fast_browse_, filter_, bookmarks_, search_, device_, selected_, jobs_};
+
+/*
+ * Identity of a listed dir (dev, inode) and its mtime/ctime
+ * when its list was last known to match it (ino is 0 if unknown).
+ */
+struct dir_stamp {
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    struct timespec ctime;
+};
 
 /*
- * Struct used to store tab's information
+ * Directory listing of a tab, done by its own thread:
+ * big dirs publish a first (partially sorted) list before the full one.
+ * state is protected by lock; taken is the last state whose list
+ * has been moved to the tab by main thread.
+ * stop is set by main thread to cancel the job;
+ * an abandoned job (eg: stuck on a hung mount) frees itself when it returns.
+ * prefetch jobs list a dir not shown yet, with low priority,
+ * stopping themselves if their list needs more than max_bytes.
+ * error is the errno that left the dir not (fully) read, if any:
+ * such a list gets no stamp, so it is never cached.
+ * opened is set once dir has been opened (and stamped).
+ * tid is job thread's id while it runs with lowered I/O priority (prefetch), else 0.
+ * inot watches the dir since before it was read; it is owned by the job
+ * until main thread takes it (then inot.fd is -1).
+ */
+struct dir_job {
+    pthread_t th;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int show_hidden;
+    int k;
+    int sorting_index;
+    struct file_list partial;
+    struct file_list list;
+    struct dir_stamp stamp;
+    volatile int stop;
+    int state;
+    int taken;
+    volatile int prefetch;
+    size_t max_bytes;
+    int error;
+    int opened;
+    pid_t tid;
+    struct inotify inot;
+};
+
+/*
+ * Struct used to store tab's information.
+ * changed: names of files changed (inotify) while dir was being listed;
+ * they will be patched in the full list.
+ * modified: names of files modified (inotify) since last refresh pass,
+ * that will stat them again.
+ * filtered: entries of nl matching filter_str, shown in filter mode.
+ * stamp: stamp of nl's dir, updated after every inotify event is patched.
  */
 struct tab {
     int curr_pos;
     char my_cwd[PATH_MAX + 1];
-    char (*nl)[PATH_MAX + 1];
+    struct file_list nl;
     int number_of_files;
     char title[PATH_MAX + 1];
     struct inotify inot;
@@ -159,6 +327,12 @@ struct tab {
     enum working_mode mode;
     int show_hidden;
     int sorting_index;
+    struct dir_job *job;
+    struct dir_stamp stamp;
+    struct file_list changed;
+    struct file_list modified;
+    struct file_list filtered;
+    char filter_str[NAME_MAX + 1];
 };
 
 /*
@@ -166,21 +340,37 @@ struct tab {
  */
 struct search_vars {
     char searched_string[20];
-    char found_searched[MAX_NUMBER_OF_FOUND][PATH_MAX + 1];
+    struct file_list found_searched;
     int searching;
     int search_archive;
     int search_lazy;
-    int found_cont;
 };
 
 /*
- * Struct that defines a list of thread job to be executed one after the other.
+ * Max number of distinct devices a job keeps track of:
+ * a job touching more of them is run alone.
+ */
+#define MAX_JOB_DEVS 16
+
+/*
+ * States of a job: a paused job is not started, or stops at its next checkpoint
+ * (keeping its devices busy) until it is resumed; a cancelled one leaves at its next checkpoint.
+ */
+enum job_states {JOB_QUEUED, JOB_RUNNING, JOB_PAUSED, JOB_CANCELLED, JOB_DONE};
+
+/*
+ * Ways a regular file can be copied, from the fastest one
+ * (sparse files get their data extents copied by any of following ones).
+ */
+enum copy_methods {COPY_CLONE, COPY_SPARSE, COPY_RANGE, COPY_SENDFILE, COPY_RW, NUM_COPY_METHODS};
+
+/*
+ * Struct that defines a list of thread jobs, run by worker threads
+ * as soon as devices they touch are not busy.
  */
 typedef struct thread_list {
     // list of file selected for this job
-    char (*selected_files)[PATH_MAX + 1];
-    // number of files selected for this job
-    int num_selected;
+    struct file_list selected_files;
     // function associated to this job
     int (*f)(void);
     // when needed: fullpath  (eg where to extract each file)
@@ -192,23 +382,47 @@ typedef struct thread_list {
     int num;
     // type of this job (needed to associate it with its function)
     int type;
+    // devices this job reads from or writes to (num_devs > MAX_JOB_DEVS if they did not fit)
+    dev_t devs[MAX_JOB_DEVS];
+    int num_devs;
+    // its job_states, and whether a worker thread has started it
+    volatile int state;
+    int started;
+    // progress, updated atomically by its worker: totals are set by pre-scan (then scanned is set)
+    uint64_t bytes_total, bytes_done;
+    int files_total, files_done, scanned;
+    // file being worked on (protected by job lock)
+    char current_file[PATH_MAX + 1];
+    // throughput sampled by main thread, in bytes (or files, if there are no bytes to count) per second:
+    // sampled is progress at sampled_at (valid only if has_sample)
+    uint64_t sampled;
+    struct timespec sampled_at;
+    int has_sample;
+    double rate;
+    // number of files copied by each of copy_methods (reported when job ends)
+    int copied_by[NUM_COPY_METHODS];
 } thread_job_list;
 
 /*
  * main_p: Needed to interrupt main cycles getch
  * from external signals;
  * nfds: number of elements in main_p struct;
- * info_fd: pipe used to pass info_msg waiting 
- * to be printed to main_poll.
+ * info_fd: eventfd that wakes up main_poll
+ * when info messages are waiting to be printed.
+ * loader_fd: eventfd written by dir_jobs when they publish a list.
+ * refresh_fd: timerfd that fires next refresh pass.
+ * prefetch_fd: timerfd that fires when cursor rested on a dir long enough to prefetch it.
+ * jobs_fd: timerfd armed by worker threads when a job starts or ends:
+ * then it fires every PROGRESS_INTERVAL ms while there are jobs, to update their progress.
  */
 struct pollfd *main_p;
-int nfds, info_fd[2];
+int nfds, info_fd, loader_fd, refresh_fd, prefetch_fd, jobs_fd;
 #if ARCHIVE_VERSION_NUMBER >= 3002000
 int archive_cb_fd[2];
 char passphrase[100];
 #endif
 thread_job_list *thread_h;
-char (*selected)[PATH_MAX + 1];
+struct file_list selected;
 struct conf config;
 struct tab ps[MAX_TABS];
 struct search_vars sv;
@@ -217,17 +431,16 @@ struct search_vars sv;
  * active win, quit status, number of worker thread jobs,
  * tabs counter and device_init status.
  * Has_X-> needed for xdg-open (if we're on a X env) and for notifications
- * num_selected -> number of selected files
  */
-int active, quit, num_of_jobs, cont, device_init, has_desktop, num_selected;
+int active, quit, num_of_jobs, cont, device_init, has_desktop;
 
 #ifdef SYSTEMD_PRESENT
 pthread_t install_th;
 #endif
-pthread_t worker_th, search_th;
+pthread_t search_th;
 
 /*
- * pointer to abstract which list of strings currently 
+ * pointer to abstract which list of files currently
  * is active for current tab
  */
-char (*str_ptr[MAX_TABS])[PATH_MAX + 1];
+struct file_list *str_ptr[MAX_TABS];
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <sys/ioctl.h>
+#include "sort.h"
+#include "selection.h"
+
+/*
+ * Max number of cached dir lists
+ */
+#define DIR_CACHE_SLOTS 32
+
+void make_stamp(const struct stat *st, struct dir_stamp *stamp);
+void cache_listing(int win);
+void cache_list(struct file_list *l, const struct dir_stamp *stamp, int show_hidden, int sorting_index);
+int is_cached(const struct dir_stamp *now);
+int cached_listing(int win, const struct dir_stamp *now);
+void free_dir_cache(void);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <time.h>
+#include "sort.h"
+#include "selection.h"
+#include "dir_cache.h"
+#include "ui.h"
+
+/*
+ * getdents64 buffer size.
+ * Dirs with more than LOADER_SYNC_MAX entries publish a partial list first.
+ */
+#define DENTS_BUF_SIZE (1024 * 1024)
+#define LOADER_SYNC_MAX 8192
+
+/*
+ * ioprio_set syscall has no glibc wrapper, nor userspace header on older systems
+ */
+#ifndef IOPRIO_CLASS_SHIFT
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_PRIO_VALUE(class, data) (((class) << IOPRIO_CLASS_SHIFT) | (data))
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+#endif
+
+int start_listing(int win, int sorting_index, int k);
+struct dir_job *start_prefetch(const char *path, int show_hidden, int sorting_index, size_t max_bytes);
+int adopt_job(int win, struct dir_job *job);
+int job_state(struct dir_job *job);
+void take_prefetch(struct dir_job *job);
+int wait_listing(int win, int timeout);
+int take_listing(int win);
+void stop_listing(int win);
+void cancel_job(struct dir_job *job);
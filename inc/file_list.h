@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef LIBURING_PRESENT
+#include <liburing.h>
+#endif
+#include "log.h"
+
+/*
+ * Directories with less entries than this are stat'ed serially
+ */
+#define STAT_PARALLEL_MIN 1024
+#define MAX_STAT_THREADS 8
+#define STAT_URING_DEPTH 256
+#define STAT_STOPPED(stop) (quit || ((stop) && *(stop)))
+#define ALL_ENTRIES(l) ((l)->num + (l)->num_hidden)
+
+/*
+ * Initial number of slots of a list's name hash (a power of 2)
+ */
+#define LIST_HASH_MIN 64
+
+void init_list(struct file_list *l, const char *prefix);
+int add_to_list(struct file_list *l, const char *name, unsigned char d_type);
+void remove_from_list(struct file_list *l, int i);
+int swap_remove_from_list(struct file_list *l, int i);
+int find_in_list(struct file_list *l, const char *name);
+uint64_t str_hash(const char *str);
+int find_prefix(struct file_list *l, const char *prefix, int start_idx);
+void drop_name_index(struct file_list *l);
+int merge_changes(struct file_list *l, struct file_list *changes, int show_hidden,
+                  int (*sort_func)(const void *, const void *, void *), int *track, int num_track, int *last);
+int filter_list(struct file_list *l, int show_hidden);
+int dup_list(struct file_list *dst, const struct file_list *src);
+size_t list_bytes(const struct file_list *l);
+void free_list(struct file_list *l);
+char *list_name(const struct file_list *l, int i);
+char *list_fullpath(const struct file_list *l, int i, char *path);
+int is_present(const char *name, const struct file_list *l, int len, int start_idx);
+void stat_list(struct file_list *l, const volatile int *stop);
+struct file_entry *list_stat(struct file_list *l, int i);
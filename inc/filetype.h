@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ncurses.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+
+/*
+ * Extensions (without leading dot) longer than this are never looked up;
+ * a name is looked up with at most its last MAX_EXT_DOTS extensions (eg: "pkg.tar.xz").
+ */
+#define MAX_EXT_LEN 16
+#define MAX_EXT_DOTS 3
+
+/*
+ * Size of extension -> category table (a power of 2),
+ * and of LS_COLORS extensions table.
+ */
+#define EXT_TABLE_SIZE 256
+#define LS_TABLE_SIZE 1024
+
+/*
+ * Color pairs: first one used for images, first one free for LS_COLORS.
+ */
+#define IMAGE_COL 6
+#define FIRST_LS_COL 7
+
+enum file_category {NO_CATEGORY, ARCHIVE_CATEGORY, PACKAGE_CATEGORY, IMAGE_CATEGORY, SOURCE_CATEGORY, COMPRESSED_CATEGORY};
+
+/*
+ * Categories that libarchive can read.
+ */
+#define IS_ARCHIVE(cat) ((cat) == ARCHIVE_CATEGORY || (cat) == PACKAGE_CATEGORY || (cat) == COMPRESSED_CATEGORY)
+
+int file_category(const char *name);
+void init_file_colors(void);
+attr_t file_color(const char *name, mode_t mode);
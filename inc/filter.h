@@ -0,0 +1,19 @@
+#pragma once
+
+#include <fnmatch.h>
+#include <limits.h>
+#include <stdint.h>
+#include <wchar.h>
+#include "fm.h"
+
+/*
+ * Lists with at least FILTER_PARALLEL_MIN entries are matched
+ * by up to MAX_FILTER_THREADS threads, FILTER_CHUNK entries at a time.
+ */
+#define FILTER_PARALLEL_MIN 65536
+#define MAX_FILTER_THREADS 8
+#define FILTER_CHUNK 16384
+
+void show_filter(void);
+void filter_key(wint_t c);
+void update_filter(int win);
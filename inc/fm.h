@@ -5,6 +5,7 @@
 #endif
 
 #include "search.h"
+#include "filter.h"
 #include "archiver.h"
 #include "worker_thread.h"
 
@@ -12,11 +13,24 @@
 #include <linux/version.h>
 #include <sys/wait.h>
 #include <sys/time.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
 
 #ifdef LIBCUPS_PRESENT
 #include "print.h"
 #endif
 
+/*
+ * Bytes copied between two cancellation checkpoints
+ */
+#define COPY_CHUNK (64 * 1024 * 1024)
+
+/*
+ * Buffer used to copy files when no in-kernel copy is available
+ */
+#define COPY_BUFF_SIZE (1024 * 1024)
+
 int change_dir(const char *str, int win);
 void change_tab(void);
 void switch_hidden(void);
@@ -28,7 +42,6 @@ void manage_all_space_press(void);
 void remove_selected(void);
 void remove_all_selected(void);
 void show_selected(void);
-void free_selected(void);
 int paste_file(void);
 int move_file(void);
 void fast_browse(wint_t c);
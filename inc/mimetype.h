@@ -0,0 +1,15 @@
+#pragma once
+
+#include <magic.h>
+#include <pthread.h>
+#include "file_list.h"
+
+/*
+ * Number of cached mimetypes, and max length of each one
+ */
+#define MIME_CACHE_SIZE 128
+#define MIMETYPE_LEN 128
+
+int get_mimetype(const char *path, const char *test);
+int read_mimetype(const char *path, char *type);
+void free_mimetypes(void);
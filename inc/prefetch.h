@@ -0,0 +1,15 @@
+#pragma once
+
+#include <sys/timerfd.h>
+#include "dir_loader.h"
+
+/*
+ * ms the cursor must rest on a dir before it is prefetched
+ */
+#define PREFETCH_DWELL 300
+
+void update_prefetch(void);
+void prefetch_timer(int fd);
+void prefetch_done(void);
+int adopt_prefetch(int win);
+void free_prefetch(void);
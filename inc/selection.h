@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+#include "file_list.h"
+
+/*
+ * Initial number of slots of selected files hash set (a power of 2)
+ */
+#define SEL_SET_MIN 64
+
+int select_path(const char *path);
+int unselect_path(const char *path);
+void unselect_listed(struct file_list *l, int num);
+int is_selected(const char *path);
+void sync_selection(struct file_list *l);
+void reset_selection(void);
+void free_selected(void);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include "file_list.h"
+
+/*
+ * Sorting modes (indexes of sorting_func and sorting_str)
+ */
+#define SORT_NAME 0
+#define SORT_SIZE 1
+#define SORT_MTIME 2
+#define SORT_TYPE 3
+#define NUM_SORTS 4
+
+/*
+ * Lists smaller than this are just qsorted
+ */
+#define RADIX_MIN 256
+
+extern int (*const sorting_func[NUM_SORTS])(const void *e1, const void *e2, void *l);
+
+int sort_list(struct file_list *l, int sorting_index, const volatile int *stop);
@@ -1,7 +1,7 @@
 #define LONG_FILE_OPERATIONS 5
 #define SHORT_FILE_OPERATIONS 3
 
-#define MODES 6
+#define MODES 8
 
 extern const char yes[];
 extern const char no[];
@@ -14,7 +14,6 @@ extern const char generic_error[];
 
 extern const char *info_win_str[3];
 
-extern const char *arch_ext[6];
 
 extern const char *sorting_str[4];
 
@@ -66,8 +65,13 @@ extern const char *thread_fail_str[LONG_FILE_OPERATIONS];
 extern const char *short_msg[SHORT_FILE_OPERATIONS];
 extern const char selected_mess[];
 
+extern const char loading_mess[];
+
 extern const char thread_running[];
 extern const char quit_with_running_thread[];
+extern const char quit_with_jobs[];
+extern const char job_cancel_str[];
+extern const char *job_state_str[];
 
 #ifdef SYSTEMD_PRESENT
 extern const char pkg_quest[];
@@ -90,6 +94,12 @@ extern const char monitor_err[];
 extern const char bookmarks_mode_str[];
 extern const char search_mode_str[];
 extern const char selected_mode_str[];
+extern const char jobs_mode_str[];
+extern const char no_jobs[];
+extern const char scanning_job[];
+extern const char *copy_method_str[];
+extern const char filter_mode_str[];
+extern const char no_match[];
 
 extern const char ac_online[];
 extern const char power_fail[];
@@ -5,6 +5,11 @@
 #include "string_constants.h"
 #include "quit.h"
 #include "utils.h"
+#include "dir_loader.h"
+#include "dir_cache.h"
+#include "prefetch.h"
+#include "selection.h"
+#include "filetype.h"
 
 #include <locale.h>
 #include <stdlib.h>
@@ -29,28 +34,49 @@
 #define EVENT_SIZE  (sizeof(struct inotify_event))
 #define BUF_LEN     (1024 * (EVENT_SIZE + 16))
 
+/*
+ * Minimum ms between two refresh passes
+ */
+#define MIN_FRAME_INTERVAL 100
+
+/*
+ * Max length of an info message
+ */
+#define INFO_MSG_LEN PATH_MAX
+
+/*
+ * Max number of already queued navigation keys collapsed into a single cursor move
+ */
+#define MAX_NAV_KEYS 256
+
 void screen_init(void);
 void screen_end(void);
 void reset_win(int win);
 void new_tab(int win);
 void resize_tab(int win, int resizing);
 void delete_tab(int win);
+void set_tab_watch(int win, const struct inotify *inot);
+void drop_tab_watch(int win);
 void scroll_down(int win, int lines);
 void scroll_up(int win, int lines);
+void move_cursor(int win, int idx);
 void trigger_show_helper_message(void);
 void trigger_stats(void);
 wint_t main_poll(WINDOW *win);
 void timer_event(void);
-void tab_refresh(int win);
-void update_special_mode(int num, char (*str)[PATH_MAX + 1], int mode);
-void show_special_tab(int num, char (*str)[PATH_MAX + 1], const char *title, int mode);
+int tab_refresh(int win);
+void tab_resort(int win);
+void update_special_mode(int num, struct file_list *str, int mode);
+void redraw_special_mode(int num, struct file_list *str, int mode);
+void show_special_tab(int num, struct file_list *str, const char *title, int mode);
 void leave_special_mode(const char *str, int win);
 void print_info(const char *str, int i);
+void refresh_info_line(void);
 void print_and_warn(const char *err, int line);
 void ask_user(const char *str, char *input, int d);
 void resize_win(void);
 void change_sort(void);
-void highlight_selected(const char *str, const char c, int win);
+void highlight_selected(int win, int line);
 void erase_selected_highlight(void);
 void update_colors(void);
 void update_time(int where);
@@ -1,16 +1,15 @@
 #pragma once
 
-#include <magic.h>
 #include <stdlib.h>
-#include "log.h"
+#include <time.h>
+#include "file_list.h"
+#include "mimetype.h"
 #include "ui.h"
 
-void *remove_from_list(int *num, char (*str)[PATH_MAX + 1], int i);
-void *safe_realloc(const size_t size, char (*str)[PATH_MAX + 1]);
-int is_ext(const char *filename, const char *ext[], int size);
-int get_mimetype(const char *path, const char *test);
 int move_cursor_to_file(int start_idx, const char *filename, int win);
 void save_old_pos(int win);
-int is_present(const char *name, char (*str)[PATH_MAX + 1], int num, int len, int start_idx);
 void change_unit(float size, char *str);
 void leave_mode_helper(struct stat s);
+int make_path(const char *cwd, const char *str, char *path);
+void make_deadline(struct timespec *ts, int timeout);
+int bounded_stat(const char *path, struct stat *st, int timeout);
@@ -10,6 +10,19 @@
 #include "notify.h"
 #endif
 
+#include <ftw.h>
+#include <sys/timerfd.h>
+
+/*
+ * Max number of worker threads running jobs at the same time.
+ */
+#define MAX_WORKERS 8
+
+/*
+ * ms between two samples of jobs progress
+ */
+#define PROGRESS_INTERVAL 1000
+
 struct thread_mesg {
     const char *str;
     int line;
@@ -18,3 +31,20 @@ struct thread_mesg {
 void init_job_queue(void);
 void destroy_job_queue(void);
 void init_thread(int type, int (* const f)(void));
+int job_cancelled(void);
+void job_progress(uint64_t bytes, int files);
+void job_file(const char *path);
+void jobs_status(char *str, size_t size);
+int running_workers(void);
+void wait_job_queue(void);
+void cancel_all_jobs(void);
+void show_jobs(void);
+void jobs_refresh(int fd);
+void show_jobs_stat(int i, char *str);
+void cancel_viewed_job(void);
+void pause_viewed_job(void);
+void move_viewed_job(int down);
+void free_jobs_view(void);
+
+// job being run by calling worker thread
+extern __thread struct thread_list *current_job;
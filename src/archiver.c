@@ -8,19 +8,25 @@ static const char *passphrase_callback(struct archive *a, void *_client_data);
 static int try_extractor(const char *tmp);
 static void extractor_thread(struct archive *a, const char *current_dir);
 
-static struct archive *archive;
-static int distance_from_root;
+// each worker thread may be archiving at the same time
+static __thread struct archive *archive;
+static __thread int distance_from_root;
+#if ARCHIVE_VERSION_NUMBER >= 3002000
+// only one extraction at a time can ask for a passphrase
+static pthread_mutex_t passphrase_lck = PTHREAD_MUTEX_INITIALIZER;
+static __thread char job_passphrase[sizeof(passphrase)];
+#endif
 
 /*
  * It tries to create a new archive to write inside it,
  * it fails if it cannot add the proper filter, or cannot set proper format, or
- * if it cannot open thread_h->full_path (ie, the desired pathname of the new archive)
+ * if it cannot open current_job->full_path (ie, the desired pathname of the new archive)
  */
 int create_archive(void) {
     archive = archive_write_new();
     if ((archive_write_add_filter_gzip(archive) == ARCHIVE_OK) &&
         (archive_write_set_format_pax_restricted(archive) == ARCHIVE_OK) &&
-        (archive_write_open_filename(archive, thread_h->full_path) == ARCHIVE_OK)) {
+        (archive_write_open_filename(archive, current_job->full_path) == ARCHIVE_OK)) {
         archiver_func();
         return 0;
     }
@@ -41,20 +47,33 @@ int create_archive(void) {
 static void archiver_func(void) {
     char path[PATH_MAX + 1] = {0};
 
-    for (int i = 0; i < thread_h->num_selected; i++) {
-        strncpy(path, thread_h->selected_files[i], PATH_MAX);
+    for (int i = 0; i < current_job->selected_files.num && !job_cancelled(); i++) {
+        strncpy(path, list_name(&current_job->selected_files, i), PATH_MAX);
         distance_from_root = strlen(dirname(path));
-        nftw(thread_h->selected_files[i], recursive_archive, 64, FTW_MOUNT | FTW_PHYS);
+        nftw(list_name(&current_job->selected_files, i), recursive_archive, 64, FTW_MOUNT | FTW_PHYS);
     }
     archive_write_free(archive);
     archive = NULL;
+    // an archive whose creation has been cancelled is removed
+    if (job_cancelled()) {
+        unlink(current_job->full_path);
+    }
 }
 
+/*
+ * Each file is a cancellation checkpoint, as each COPY_CHUNK archived.
+ * Job progress is updated after each read and each file.
+ */
 static int recursive_archive(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf) {
     char entry_name[PATH_MAX + 1] = {0};
     int fd;
-    struct archive_entry *entry = archive_entry_new();
+    struct archive_entry *entry;
 
+    if (job_cancelled()) {
+        return -1;
+    }
+    job_file(path);
+    entry = archive_entry_new();
     strncpy(entry_name, path + distance_from_root + 1, PATH_MAX);
     archive_entry_set_pathname(entry, entry_name);
     archive_entry_copy_stat(entry, sb);
@@ -63,24 +82,35 @@ static int recursive_archive(const char *path, const struct stat *sb, int typefl
     fd = open(path, O_RDONLY);
     if (fd != -1) {
         char buff[BUFF_SIZE] = {0};
-        int len;
+        int len, copied = 0;
         
         len = read(fd, buff, sizeof(buff));
         while (len > 0) {
             archive_write_data(archive, buff, len);
+            job_progress(len, 0);
+            copied += len;
+            if (copied >= COPY_CHUNK) {
+                if (job_cancelled()) {
+                    break;
+                }
+                copied = 0;
+            }
             len = read(fd, buff, sizeof(buff));
         }
         close(fd);
     }
-    return 0;
+    job_progress(0, 1);
+    return job_cancelled() ? -1 : 0;
 }
 
 int extract_file(void) {
     int ret = 0;
     
-    for (int i = 0; i < thread_h->num_selected; i++) {
-        if (is_ext(thread_h->selected_files[i], arch_ext, NUM(arch_ext))) {
-            ret += try_extractor(thread_h->selected_files[i]);
+    for (int i = 0; i < current_job->selected_files.num && !job_cancelled(); i++) {
+        const char *str = list_name(&current_job->selected_files, i);
+        
+        if (IS_ARCHIVE(file_category(str))) {
+            ret += try_extractor(str);
         } else {
             ret--;
         }
@@ -91,17 +121,18 @@ int extract_file(void) {
 #if ARCHIVE_VERSION_NUMBER >= 3002000
 static const char *passphrase_callback(struct archive *a, void *_client_data) {
     uint64_t u = 1;
+    int ret = -1;
     
-    if (eventfd_write(archive_cb_fd[0], u) == -1) {
-        return NULL;
-    }
-    if (eventfd_read(archive_cb_fd[1], &u) == -1) {
-        return NULL;
+    pthread_mutex_lock(&passphrase_lck);
+    if (eventfd_write(archive_cb_fd[0], u) != -1 && eventfd_read(archive_cb_fd[1], &u) != -1) {
+        strncpy(job_passphrase, passphrase, sizeof(job_passphrase) - 1);
+        ret = 0;
     }
-    if (quit || passphrase[0] == 27) {
+    pthread_mutex_unlock(&passphrase_lck);
+    if (ret == -1 || quit || job_passphrase[0] == 27) {
         return NULL;
     }
-    return passphrase;
+    return job_passphrase;
 }
 #endif
 
@@ -120,29 +151,34 @@ static int try_extractor(const char *tmp) {
         strncpy(path, tmp, PATH_MAX);
         char *current_dir = dirname(path);
         extractor_thread(a, current_dir);
+        job_progress(0, 1);
         return 0;
     }
     archive_read_free(a);
+    job_progress(0, 1);
     return -1;
 }
 
 /*
  * calculates current_dir path, then creates the write_disk_archive that
  * will read from the selected archives and will write files on disk.
- * While there are headers inside the archive being read, it goes on copying data from
- * the read archive to the disk.
+ * While there are headers inside the archive being read (and job is not cancelled),
+ * it goes on copying data from the read archive to the disk.
+ * Job progress is measured in bytes read from the archive file.
  */
 static void extractor_thread(struct archive *a, const char *current_dir) {
     struct archive *ext;
     struct archive_entry *entry;
     int flags = ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_ACL | ARCHIVE_EXTRACT_FFLAGS;
+    int copied;
+    int64_t read_bytes = 0;
     char buff[BUFF_SIZE], fullpathname[PATH_MAX + 1];
     char name[PATH_MAX + 1] = {0}, tmp_name[PATH_MAX + 1] = {0};
 
     ext = archive_write_disk_new();
     archive_write_disk_set_options(ext, flags);
     archive_write_disk_set_standard_lookup(ext);
-    while (archive_read_next_header(a, &entry) != ARCHIVE_EOF) {
+    while (!job_cancelled() && archive_read_next_header(a, &entry) != ARCHIVE_EOF) {
         strncpy(name, archive_entry_pathname(entry), PATH_MAX);
         int num = 0;
         /* avoid overwriting a file/dir in path if it has the same name of a file being extracted there */
@@ -152,19 +188,33 @@ static void extractor_thread(struct archive *a, const char *current_dir) {
             tmp_name[0] = '\0';
         }
         int len = strlen(name) - strlen(tmp_name);
-        while (access(name, F_OK) == 0) {
+        // process cwd is not current_dir: check full path
+        snprintf(fullpathname, PATH_MAX, "%s/%s", current_dir, name);
+        while (access(fullpathname, F_OK) == 0) {
             num++;
             snprintf(name + len, PATH_MAX - len, "%d%s", num, tmp_name);
+            snprintf(fullpathname, PATH_MAX, "%s/%s", current_dir, name);
         }
-        snprintf(fullpathname, PATH_MAX, "%s/%s", current_dir, name);
         archive_entry_set_pathname(entry, fullpathname);
+        job_file(fullpathname);
         archive_write_header(ext, entry);
+        copied = 0;
         len = archive_read_data(a, buff, sizeof(buff));
         while (len > 0) {
             archive_write_data(ext, buff, len);
+            job_progress(archive_filter_bytes(a, -1) - read_bytes, 0);
+            read_bytes = archive_filter_bytes(a, -1);
+            copied += len;
+            if (copied >= COPY_CHUNK) {
+                if (job_cancelled()) {
+                    break;
+                }
+                copied = 0;
+            }
             len = archive_read_data(a, buff, sizeof(buff));
         }
     }
+    job_progress(archive_filter_bytes(a, -1) - read_bytes, 0);
     archive_read_free(a);
     archive_write_free(ext);
 }
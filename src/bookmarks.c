@@ -3,10 +3,10 @@
 static void get_xdg_dirs(void);
 static void remove_bookmark(int idx);
 
-static int num_bookmarks, xdg_bookmarks;
+static int xdg_bookmarks;
 static char home_dir[PATH_MAX + 1];
 static char fullpath[PATH_MAX + 1];
-static char (*bookmarks)[PATH_MAX + 1];
+static struct file_list bookmarks;
 
 void get_bookmarks(void) {
     FILE *f;
@@ -24,8 +24,8 @@ void get_bookmarks(void) {
         char str[PATH_MAX + 1] = {0};
         
         while (fgets(str, PATH_MAX, f)) {
-            bookmarks = safe_realloc(++num_bookmarks, bookmarks);
-            strncpy(bookmarks[num_bookmarks - 1], str, PATH_MAX);
+            str[strcspn(str, "\n")] = '\0';
+            add_to_list(&bookmarks, str, DT_UNKNOWN);
         }
         fclose(f);
     } else {
@@ -44,7 +44,7 @@ static void get_xdg_dirs(void) {
     }
 
     if ((f = fopen(file_path, "r"))) {
-        char str[PATH_MAX + 1] = {0};
+        char str[PATH_MAX + 1] = {0}, path[PATH_MAX + 1] = {0};
         
         while (fgets(line, sizeof(line), f)) {
             // avoid comments
@@ -53,11 +53,11 @@ static void get_xdg_dirs(void) {
             }
             strncpy(str, strchr(line, '/') + 1, PATH_MAX);
             str[strlen(str) - 2] = '\0'; // -1 for newline - 1 for closing Double quotation mark
-            bookmarks = safe_realloc(++num_bookmarks, bookmarks);
-            snprintf(bookmarks[num_bookmarks - 1], PATH_MAX, "%s/%s", home_dir, str);
+            snprintf(path, PATH_MAX, "%s/%s", home_dir, str);
+            add_to_list(&bookmarks, path, DT_DIR);
         }
         fclose(f);
-        xdg_bookmarks = num_bookmarks;
+        xdg_bookmarks = bookmarks.num;
     }
 }
 
@@ -65,7 +65,7 @@ void add_file_to_bookmarks(const char *str) {
     FILE *f;
     char c;
 
-    int present = is_present(str, bookmarks, num_bookmarks, -1, 0);
+    int present = is_present(str, &bookmarks, -1, 0);
     if (present != -1) {
         if (config.safe == FULL_SAFE) {
             ask_user(_(bookmark_already_present), &c, 1);
@@ -85,9 +85,8 @@ void add_file_to_bookmarks(const char *str) {
         fprintf(f, "%s\n", str);
         fclose(f);
         print_info(_(bookmark_added), INFO_LINE);
-        bookmarks = safe_realloc(++num_bookmarks, bookmarks);
-        strncpy(bookmarks[num_bookmarks - 1], str, PATH_MAX);
-        update_special_mode(num_bookmarks, bookmarks, bookmarks_);
+        add_to_list(&bookmarks, str, DT_UNKNOWN);
+        update_special_mode(bookmarks.num, &bookmarks, bookmarks_);
     } else {
         print_info(_(bookmarks_file_err), ERR_LINE);
     }
@@ -113,21 +112,21 @@ static void remove_bookmark(int idx) {
     FILE *f;
     
     if ((f = fopen(fullpath, "w"))) {
-        bookmarks = remove_from_list(&num_bookmarks, bookmarks, idx);
+        remove_from_list(&bookmarks, idx);
         print_info(_(bookmarks_rm), INFO_LINE);
-        for (idx = xdg_bookmarks; idx < num_bookmarks; idx++) {
-            fprintf(f, "%s\n", bookmarks[idx]);
+        for (idx = xdg_bookmarks; idx < bookmarks.num; idx++) {
+            fprintf(f, "%s\n", list_name(&bookmarks, idx));
         }
         fclose(f);
-        update_special_mode(num_bookmarks, bookmarks, bookmarks_);
+        update_special_mode(bookmarks.num, &bookmarks, bookmarks_);
     } else {
         print_info(_(bookmarks_file_err), ERR_LINE);
     }
 }
 
 void show_bookmarks(void) {
-    if (num_bookmarks) {
-        show_special_tab(num_bookmarks, bookmarks, bookmarks_mode_str, bookmarks_);
+    if (bookmarks.num) {
+        show_special_tab(bookmarks.num, &bookmarks, bookmarks_mode_str, bookmarks_);
     } else {
         print_info(_(no_bookmarks), INFO_LINE);
     }
@@ -136,7 +135,8 @@ void show_bookmarks(void) {
 void manage_enter_bookmarks(struct stat current_file_stat) {
     char c;
     
-    if (access(str_ptr[active][ps[active].curr_pos], F_OK ) != -1 ) {
+    // bookmark has been stat'ed (with a bounded wait) by main loop
+    if (current_file_stat.st_mode) {
         leave_mode_helper(current_file_stat);
     } else {
         if (config.safe == FULL_SAFE) {
@@ -151,14 +151,12 @@ void manage_enter_bookmarks(struct stat current_file_stat) {
 }
 
 void remove_all_user_bookmarks(void) {
-    for (int i = num_bookmarks - 1; i >= xdg_bookmarks; i--) {
+    for (int i = bookmarks.num - 1; i >= xdg_bookmarks; i--) {
         remove_bookmark(i);
     }
     print_info(_(bookmarks_cleared), INFO_LINE);
 }
 
 void free_bookmarks(void) {
-    if (bookmarks) {
-        free(bookmarks);
-    }
+    free_list(&bookmarks);
 }
@@ -131,6 +131,10 @@ static void read_config_file(const char *dir) {
             strncpy(config.sysinfo_layout, sysinfo, sizeof(config.sysinfo_layout));
         }
         config_lookup_int(&cfg, "safe", &config.safe);
+        config_lookup_int(&cfg, "loading_timeout", &config.loading_timeout);
+        config_lookup_int(&cfg, "refresh_delay", &config.refresh_delay);
+        config_lookup_int(&cfg, "dir_cache_size", &config.dir_cache_size);
+        config_lookup_int(&cfg, "jobs_per_device", &config.jobs_per_device);
     } else {
         fprintf(stderr, "Config file: %s at line %d.\n",
                 config_error_text(&cfg),
@@ -161,4 +165,16 @@ void config_checks(void) {
     if (config.safe < UNSAFE || config.safe > FULL_SAFE) {
         config.safe = FULL_SAFE;
     }
+    if (config.loading_timeout < 0) {
+        config.loading_timeout = 0;
+    }
+    if (config.refresh_delay < 0) {
+        config.refresh_delay = 0;
+    }
+    if (config.dir_cache_size < 0) {
+        config.dir_cache_size = 0;
+    }
+    if (config.jobs_per_device < 1) {
+        config.jobs_per_device = 1;
+    }
 }
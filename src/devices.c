@@ -20,8 +20,7 @@ static int remove_device(const char *name);
 
 static char mount_str[PATH_MAX + 1];
 static struct udev *udev;
-static int number_of_devices;
-static char (*devices)[PATH_MAX + 1];
+static struct file_list devices;
 static sd_bus *bus;
 
 /*
@@ -35,27 +34,15 @@ static int mount_fs(const char *str, int mount) {
     char obj_path[PATH_MAX + 1] = "/org/freedesktop/UDisks2/block_devices/";
     char tmp[30], method[10];
     int r, ret = -1;
-    char mounted_path[PATH_MAX + 1] = {0};
-    int len, len2;
 
     r = sd_bus_open_system(&mount_bus);
     if (r < 0) {
         print_and_warn(strerror(-r), ERR_LINE);
         goto finish;
     }
+    // process cwd never follows tabs: no need to move it away from mounted path.
+    // Tabs inside an unmounted path are moved by fix_tab_cwd.
     if (mount) {
-        if (get_mount_point(str, mounted_path) == -1) {
-            ERROR("Could not get mount point.");
-        }
-        // calculate root dir of mounted path
-        strncpy(mounted_path, dirname(mounted_path), PATH_MAX);
-        len = strlen(mounted_path);
-        len2 = strlen(ps[active].my_cwd);
-        // if active win is inside mounted path
-        if (!strncmp(ps[active].my_cwd, mounted_path, len) && len2 > len) {
-            // move away process' cwd from mounted path as it would raise an error while unmounting
-            chdir(mounted_path);
-        }
         strcpy(method, "Unmount");
     } else {
         strcpy(method, "Mount");
@@ -73,8 +60,6 @@ static int mount_fs(const char *str, int mount) {
                            "a{sv}",
                            NULL);
     if (r < 0) {
-        /* if it was not succesful, restore old_cwd */
-        chdir(ps[active].my_cwd);
         print_and_warn(error.message, ERR_LINE);
         goto finish;
     }
@@ -88,11 +73,6 @@ static int mount_fs(const char *str, int mount) {
             set_autoclear(str);
         }
     } else {
-        /*
-         * save back in ps[active].my_cwd, process' cwd
-         * to be sure we carry the right path
-         */
-        getcwd(ps[active].my_cwd, PATH_MAX);
         snprintf(mount_str, PATH_MAX, _(dev_unmounted), str);
         INFO("Unmounted.");
     }
@@ -392,7 +372,7 @@ static int add_callback(sd_bus_message *m, void *userdata, sd_bus_error *ret_err
                 r = add_device(dev, devname);
                 udev_device_unref(dev);
                 if (!quit && r != -1) {
-                    update_special_mode(number_of_devices, devices, device_);
+                    update_special_mode(devices.num, &devices, device_);
                 }
             }
         } else {
@@ -423,7 +403,7 @@ static int remove_callback(sd_bus_message *m, void *userdata, sd_bus_error *ret_
             snprintf(devname, PATH_MAX, "/dev/%s", name);
             r = remove_device(devname);
             if (!quit && r != -1) {
-                update_special_mode(number_of_devices, devices, device_);
+                update_special_mode(devices.num, &devices, device_);
             }
         } else {
             INFO("signal discarded.");
@@ -451,7 +431,7 @@ static int change_callback(sd_bus_message *m, void *userdata, sd_bus_error *ret_
             INFO("PropertiesChanged UDisks2 signal received!");
             const char *name = sd_bus_message_get_path(m);
             snprintf(devname, PATH_MAX, "/dev/%s", strrchr(name, '/') + 1);
-            int present = is_present(devname, devices, number_of_devices, strlen(devname), 0);
+            int present = is_present(devname, &devices, strlen(devname), 0);
             if (present != -1) {
                 change_mounted_status(present, devname);
                 update_special_mode(present, NULL, device_);
@@ -489,8 +469,8 @@ void devices_bus_process(void) {
  * change tab title, and calls reset_win()
  */
 void show_devices_tab(void) {
-    if (number_of_devices) {
-        show_special_tab(number_of_devices, devices, device_mode_str, device_);
+    if (devices.num) {
+        show_special_tab(devices.num, &devices, device_mode_str, device_);
     } else {
         print_info(_(no_devices), INFO_LINE);
     }
@@ -499,7 +479,7 @@ void show_devices_tab(void) {
 /*
  * Scan "block" subsystem for devices.
  * For each device check if it is a really mountable external fs,
- * add it to devices{} and increment number_of_devices.
+ * add it to devices list.
  */
 static void enumerate_block_devices(void) {
     struct udev_enumerate *enumerate;
@@ -561,14 +541,14 @@ static int get_mount_point(const char *dev_path, char *path) {
  */
 void manage_mount_device(void) {
     int mount;
-    int pos = ps[active].curr_pos;
-    int len = strlen(devices[pos]);
-    char *ptr = strchr(devices[pos], ',');
+    char *dev = list_name(&devices, ps[active].curr_pos);
+    int len = strlen(dev);
+    char *ptr = strchr(dev, ',');
     char name[PATH_MAX + 1];
 
-    strncpy(name, devices[pos], PATH_MAX);
+    strncpy(name, dev, PATH_MAX);
     name[len - strlen(ptr)] = '\0';
-    mount = devices[pos][len - 1] - '0';
+    mount = dev[len - 1] - '0';
     mount_fs(name, mount);
 }
 
@@ -578,13 +558,13 @@ void manage_mount_device(void) {
  */
 void manage_enter_device(void) {
     int mount, ret = 1;
-    int pos = ps[active].curr_pos;
-    int len = strlen(devices[pos]);
-    char *ptr = strchr(devices[pos], ',');
+    char *dev = list_name(&devices, ps[active].curr_pos);
+    int len = strlen(dev);
+    char *ptr = strchr(dev, ',');
     char dev_path[PATH_MAX + 1] = {0}, name[PATH_MAX + 1] = {0};
 
-    mount = devices[pos][len - 1] - '0';
-    strncpy(dev_path, devices[pos], PATH_MAX);
+    mount = dev[len - 1] - '0';
+    strncpy(dev_path, dev, PATH_MAX);
     dev_path[len - strlen(ptr)] = '\0';
     if (!mount) {
         ret = mount_fs(dev_path, mount);
@@ -596,9 +576,10 @@ void manage_enter_device(void) {
 }
 
 static void change_mounted_status(int pos, const char *name) {
-    int len = strlen(devices[pos]);
-    int mount = devices[pos][len - 1] - '0';
-    sprintf(devices[pos] + len - 1, "%d", !mount);
+    char *dev = list_name(&devices, pos);
+    int len = strlen(dev);
+    int mount = dev[len - 1] - '0';
+    sprintf(dev + len - 1, "%d", !mount);
     if (!strlen(mount_str)) {
         if (mount) {
             snprintf(mount_str, PATH_MAX, _(ext_dev_unmounted), name);
@@ -641,9 +622,7 @@ void free_device_monitor(void) {
     if (bus) {
         sd_bus_flush_close_unref(bus);
     }
-    if (devices) {
-        free(devices);
-    }
+    free_list(&devices);
     if (udev) {
         udev_unref(udev);
     }
@@ -668,16 +647,16 @@ static int add_device(struct udev_device *dev, const char *name) {
         mount = get_mount_point(name, NULL);
     }
     if (mount != -1) {
-        devices = safe_realloc(number_of_devices + 1, devices);
-        if (!quit) {
-            if (udev_device_get_property_value(dev, "ID_MODEL")) {
-                snprintf(devices[number_of_devices], PATH_MAX, "%s, %s, Mounted: %d",
-                        name, udev_device_get_property_value(dev, "ID_MODEL"), mount);
-            } else {
-                snprintf(devices[number_of_devices], PATH_MAX, "%s, Mounted: %d",
-                        name, mount);
-            }
-            number_of_devices++;
+        char str[PATH_MAX + 1] = {0};
+        
+        if (udev_device_get_property_value(dev, "ID_MODEL")) {
+            snprintf(str, PATH_MAX, "%s, %s, Mounted: %d",
+                    name, udev_device_get_property_value(dev, "ID_MODEL"), mount);
+        } else {
+            snprintf(str, PATH_MAX, "%s, Mounted: %d",
+                    name, mount);
+        }
+        if (add_to_list(&devices, str, DT_BLK) != -1) {
             INFO(device_added);
             print_info(_(device_added), INFO_LINE);
             int is_loop_dev = !strncmp(name, "/dev/loop", strlen("/dev/loop"));
@@ -690,10 +669,10 @@ static int add_device(struct udev_device *dev, const char *name) {
 }
 
 static int remove_device(const char *name) {
-    int i = is_present(name, devices, number_of_devices, strlen(name), 0);
+    int i = is_present(name, &devices, strlen(name), 0);
 
     if (i != -1) {
-        devices = remove_from_list(&number_of_devices, devices, i);
+        remove_from_list(&devices, i);
         if (!quit) {
             print_info(_(device_removed), INFO_LINE);
             INFO(device_removed);
@@ -711,10 +690,11 @@ void show_devices_stat(int i, int win, char *str) {
     char s[20] = {0};
     uint64_t total;
     
-    int len = strlen(devices[i]);
-    int mount = devices[i][len - 1] - '0';
-    strncpy(dev_path, devices[i], PATH_MAX);
-    char *ptr = strchr(devices[i], ',');
+    const char *device = list_name(&devices, i);
+    int len = strlen(device);
+    int mount = device[len - 1] - '0';
+    strncpy(dev_path, device, PATH_MAX);
+    char *ptr = strchr(device, ',');
     dev_path[len - strlen(ptr)] = '\0';
     // if device is mounted
     if (mount && get_mount_point(dev_path, path) != -1) {
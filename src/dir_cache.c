@@ -0,0 +1,206 @@
+#include "../inc/dir_cache.h"
+
+/*
+ * A list left by a tab, with the show_hidden/sorting_index it was listed with.
+ * used is the value of cache_clock when it was cached (0 for empty slots).
+ */
+struct cached_dir {
+    struct dir_stamp stamp;
+    struct file_list list;
+    int show_hidden;
+    int sorting_index;
+    size_t bytes;
+    unsigned long used;
+};
+
+static int in_sync(int win);
+static int same_stamp(const struct dir_stamp *a, const struct dir_stamp *b);
+static void drop_cached(struct cached_dir *c);
+static struct cached_dir *free_slot(size_t bytes, size_t budget);
+
+static struct cached_dir dir_cache[DIR_CACHE_SLOTS];
+static size_t cache_bytes;
+static unsigned long cache_clock;
+
+void make_stamp(const struct stat *st, struct dir_stamp *stamp) {
+    stamp->dev = st->st_dev;
+    stamp->ino = st->st_ino;
+    stamp->mtime = st->st_mtim;
+    stamp->ctime = st->st_ctim;
+}
+
+/*
+ * Moves win's list to the cache, right before it is replaced.
+ * Only lists known to match their dir are cached (see in_sync).
+ * Note that dir stamp does not change when a file is just written:
+ * files modified while their dir is not shown keep their old stats.
+ */
+void cache_listing(int win) {
+    if (in_sync(win) && ps[win].nl.prefix_len) {
+        cache_list(&ps[win].nl, &ps[win].stamp, ps[win].show_hidden, ps[win].sorting_index);
+    }
+}
+
+/*
+ * Moves l (listed with show_hidden and sorting_index, when its dir had stamp) to the cache.
+ * An older list of the same dir is dropped, and least recently cached ones
+ * are evicted to stay inside config.dir_cache_size MB.
+ * If it does not fit, l is just freed.
+ */
+void cache_list(struct file_list *l, const struct dir_stamp *stamp, int show_hidden, int sorting_index) {
+    const size_t budget = (size_t)config.dir_cache_size << 20;
+    struct cached_dir *c;
+    size_t bytes;
+    
+    drop_name_index(l);
+    bytes = list_bytes(l);
+    if (bytes > budget || !stamp->ino) {
+        free_list(l);
+        return;
+    }
+    for (int i = 0; i < DIR_CACHE_SLOTS; i++) {
+        if (dir_cache[i].used && dir_cache[i].stamp.dev == stamp->dev && dir_cache[i].stamp.ino == stamp->ino) {
+            drop_cached(&dir_cache[i]);
+        }
+    }
+    c = free_slot(bytes, budget);
+    c->stamp = *stamp;
+    c->list = *l;
+    c->show_hidden = show_hidden;
+    c->sorting_index = sorting_index;
+    c->bytes = bytes;
+    c->used = ++cache_clock;
+    cache_bytes += bytes;
+    // list's arrays are now owned by the cache
+    init_list(l, NULL);
+}
+
+/*
+ * Whether an up to date list of the dir stamped now (by a dir_job) is cached, or shown by a tab.
+ */
+int is_cached(const struct dir_stamp *now) {
+    for (int i = 0; i < cont; i++) {
+        if (same_stamp(&ps[i].stamp, now)) {
+            return 1;
+        }
+    }
+    for (int i = 0; i < DIR_CACHE_SLOTS; i++) {
+        if (dir_cache[i].used && same_stamp(&dir_cache[i].stamp, now)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Looks for an up to date list of win's cwd, as stamped now by its dir_job: first in the other tab
+ * (if it is showing the same dir, its list is copied),
+ * then in the cache (list is moved back to the tab; a stale one is dropped).
+ * Found list is filtered/sorted again if it was listed with different settings.
+ * Returns 0 if ps[win].nl has been replaced, -1 otherwise.
+ */
+int cached_listing(int win, const struct dir_stamp *now) {
+    struct file_list found, *l = &found, tmp;
+    int show_hidden = -1, sorting_index = -1;
+    
+    if (!config.dir_cache_size || !now->ino) {
+        return -1;
+    }
+    for (int i = 0; i < cont && show_hidden == -1; i++) {
+        if (i != win && same_stamp(&ps[i].stamp, now) && in_sync(i)) {
+            if (dup_list(l, &ps[i].nl) == -1) {
+                return -1;
+            }
+            show_hidden = ps[i].show_hidden;
+            sorting_index = ps[i].sorting_index;
+        }
+    }
+    for (int i = 0; i < DIR_CACHE_SLOTS && show_hidden == -1; i++) {
+        struct cached_dir *c = &dir_cache[i];
+        
+        if (c->used && c->stamp.dev == now->dev && c->stamp.ino == now->ino) {
+            if (!same_stamp(&c->stamp, now)) {
+                drop_cached(c);
+                return -1;
+            }
+            *l = c->list;
+            show_hidden = c->show_hidden;
+            sorting_index = c->sorting_index;
+            cache_bytes -= c->bytes;
+            init_list(&c->list, NULL);
+            c->used = 0;
+        }
+    }
+    if (show_hidden == -1) {
+        return -1;
+    }
+    // dir may have been reached through another path (eg: a bind mount)
+    init_list(&tmp, ps[win].my_cwd);
+    memcpy(l->prefix, tmp.prefix, sizeof(l->prefix));
+    l->prefix_len = tmp.prefix_len;
+    free_list(&ps[win].nl);
+    ps[win].nl = found;
+    l = &ps[win].nl;
+    ps[win].stamp = *now;
+    if (show_hidden != ps[win].show_hidden || sorting_index != ps[win].sorting_index) {
+        filter_list(l, ps[win].show_hidden);
+        sort_list(l, ps[win].sorting_index, NULL);
+    }
+    // selection may have changed since list was cached
+    sync_selection(l);
+    return 0;
+}
+
+void free_dir_cache(void) {
+    for (int i = 0; i < DIR_CACHE_SLOTS; i++) {
+        if (dir_cache[i].used) {
+            drop_cached(&dir_cache[i]);
+        }
+    }
+}
+
+/*
+ * Whether win's list surely matches its dir, as of its stamp:
+ * it has been completely listed, and no inotify event
+ * nor modified file is waiting to be patched in.
+ */
+static int in_sync(int win) {
+    int pending = 0;
+    
+    return !ps[win].job && ps[win].stamp.ino && !ps[win].modified.num
+           && ioctl(ps[win].inot.fd, FIONREAD, &pending) == 0 && !pending;
+}
+
+static int same_stamp(const struct dir_stamp *a, const struct dir_stamp *b) {
+    return a->ino && a->dev == b->dev && a->ino == b->ino
+           && a->mtime.tv_sec == b->mtime.tv_sec && a->mtime.tv_nsec == b->mtime.tv_nsec
+           && a->ctime.tv_sec == b->ctime.tv_sec && a->ctime.tv_nsec == b->ctime.tv_nsec;
+}
+
+static void drop_cached(struct cached_dir *c) {
+    free_list(&c->list);
+    cache_bytes -= c->bytes;
+    c->used = 0;
+}
+
+/*
+ * Evicts least recently cached lists until a slot is empty
+ * and bytes more bytes fit inside budget.
+ */
+static struct cached_dir *free_slot(size_t bytes, size_t budget) {
+    for (;;) {
+        struct cached_dir *empty = NULL, *lru = NULL;
+        
+        for (int i = 0; i < DIR_CACHE_SLOTS; i++) {
+            if (!dir_cache[i].used) {
+                empty = &dir_cache[i];
+            } else if (!lru || dir_cache[i].used < lru->used) {
+                lru = &dir_cache[i];
+            }
+        }
+        if (empty && cache_bytes + bytes <= budget) {
+            return empty;
+        }
+        drop_cached(lru);
+    }
+}
@@ -0,0 +1,471 @@
+#include "../inc/dir_loader.h"
+
+static struct dir_job *new_job(const char *path, int show_hidden, int sorting_index, int k);
+static void *dir_job_thread(void *x);
+static void set_io_priority(pid_t tid, int prefetch);
+static void load_dir(struct dir_job *job);
+static int over_budget(struct dir_job *job);
+static int publish(struct dir_job *job, int state);
+static void free_job(struct dir_job *job);
+static int read_dents(int fd, char *buf, struct file_list *l);
+static int copy_list(struct file_list *dst, const struct file_list *src);
+static void partial_sort(struct file_list *l, int k, int (*sort_func)(const void *, const void *, void *));
+static void sift_down(struct file_list *l, int i, int n, int (*sort_func)(const void *, const void *, void *));
+
+/*
+ * Layout of entries returned by getdents64 syscall.
+ */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/*
+ * Starts a dir_job listing ps[win].my_cwd, sorted by sorting_index.
+ * k is the number of visible rows: if dir is big, a partial list
+ * with just its first k entries sorted is published first.
+ * If job thread cannot be started, dir is listed right now.
+ */
+int start_listing(int win, int sorting_index, int k) {
+    struct dir_job *job = new_job(ps[win].my_cwd, ps[win].show_hidden, sorting_index, k);
+
+    if (!job) {
+        return -1;
+    }
+    ps[win].job = job;
+    if (pthread_create(&job->th, NULL, dir_job_thread, job)) {
+        WARN("could not start dir job thread.");
+        job->th = 0;
+        load_dir(job);
+    }
+    return 0;
+}
+
+/*
+ * Starts a low priority dir_job listing path in background (no partial list is published).
+ * It stops as soon as its list needs more than max_bytes.
+ * Returns NULL if its thread could not be started: prefetching is only an optimization.
+ */
+struct dir_job *start_prefetch(const char *path, int show_hidden, int sorting_index, size_t max_bytes) {
+    struct dir_job *job = new_job(path, show_hidden, sorting_index, 0);
+
+    if (job) {
+        job->prefetch = 1;
+        job->max_bytes = max_bytes;
+        if (pthread_create(&job->th, NULL, dir_job_thread, job)) {
+            free_job(job);
+            job = NULL;
+        }
+    }
+    return job;
+}
+
+/*
+ * Makes a (still running or done) prefetch job win's one, as if it was started by start_listing:
+ * it gets back normal priority and no more memory limit, and nothing of it has been taken yet.
+ * Priority is restored right now on job thread (a done job's thread may be gone),
+ * so that stat threads it starts afterwards inherit it too.
+ * Fails if job already stopped for exceeding its limit.
+ */
+int adopt_job(int win, struct dir_job *job) {
+    int ret = -1;
+
+    pthread_mutex_lock(&job->lock);
+    if (!job->stop) {
+        if (job->tid && job->state != LOAD_DONE) {
+            set_io_priority(job->tid, 0);
+        }
+        job->prefetch = 0;
+        job->max_bytes = 0;
+        job->taken = LOAD_RUNNING;
+        ps[win].job = job;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&job->lock);
+    return ret;
+}
+
+int job_state(struct dir_job *job) {
+    int ret;
+
+    pthread_mutex_lock(&job->lock);
+    ret = job->state;
+    pthread_mutex_unlock(&job->lock);
+    return ret;
+}
+
+/*
+ * Joins a done prefetch job, moving its list to dir cache
+ * (unless it stopped before reading the whole dir), then frees it.
+ */
+void take_prefetch(struct dir_job *job) {
+    pthread_join(job->th, NULL);
+    if (!job->stop) {
+        cache_list(&job->list, &job->stamp, job->show_hidden, job->sorting_index);
+    }
+    free_job(job);
+}
+
+/*
+ * Waits at most timeout ms for win's job to publish a list,
+ * then moves it to the tab (take_listing).
+ * Returns the state taken, or -1 if there is still no list to show.
+ */
+int wait_listing(int win, int timeout) {
+    struct timespec ts;
+    int state;
+
+    make_deadline(&ts, timeout);
+    do {
+        struct dir_job *job = ps[win].job;
+        int timed_out = 0;
+        
+        pthread_mutex_lock(&job->lock);
+        while (job->state == job->taken && !quit && !timed_out) {
+            timed_out = pthread_cond_timedwait(&job->cond, &job->lock, &ts) == ETIMEDOUT;
+        }
+        pthread_mutex_unlock(&job->lock);
+        // a stamped job has no list yet (unless its dir was cached)
+        if ((state = take_listing(win)) == LOAD_STAMPED) {
+            state = timed_out ? -1 : LOAD_RUNNING;
+        }
+    } while (state == LOAD_RUNNING && !quit);
+    return state;
+}
+
+/*
+ * If win's job published a new list, it replaces ps[win].nl
+ * (with selected files flagged).
+ * Once job opened its dir, tab takes its inotify watch, and if an up to date list
+ * of the dir is cached (or shown by the other tab), that one is used and job is stopped.
+ * Once full list is taken, job is freed; if dir could not be (fully) read, user is told why:
+ * if it could not even be opened, LOAD_FAILED is returned, and only ".." is listed.
+ * Returns the state taken, or -1 if there was nothing new.
+ */
+int take_listing(int win) {
+    struct dir_job *job = ps[win].job;
+    int state;
+
+    if (!job) {
+        return -1;
+    }
+    pthread_mutex_lock(&job->lock);
+    state = job->state;
+    pthread_mutex_unlock(&job->lock);
+    if (state == job->taken) {
+        return -1;
+    }
+    if (job->taken == LOAD_RUNNING && job->opened) {
+        set_tab_watch(win, &job->inot);
+        job->inot.fd = -1;
+        job->taken = LOAD_STAMPED;
+        if (cached_listing(win, &job->stamp) == 0) {
+            stop_listing(win);
+            return LOAD_DONE;
+        }
+        if (state == LOAD_STAMPED) {
+            return LOAD_STAMPED;
+        }
+    }
+    free_list(&ps[win].nl);
+    if (state == LOAD_PARTIAL) {
+        ps[win].nl = job->partial;
+        // list's arrays are now owned by ps[win].nl
+        init_list(&job->partial, NULL);
+        job->taken = LOAD_PARTIAL;
+    } else {
+        if (job->th) {
+            pthread_join(job->th, NULL);
+        }
+        ps[win].nl = job->list;
+        ps[win].stamp = job->stamp;
+        if (job->error) {
+            print_info(strerror(job->error), ERR_LINE);
+        }
+        if (!job->opened) {
+            // let user leave
+            add_to_list(&ps[win].nl, "..", DT_DIR);
+            state = LOAD_FAILED;
+        }
+        init_list(&job->list, NULL);
+        free_job(job);
+        ps[win].job = NULL;
+    }
+    if (selected.num) {
+        sync_selection(&ps[win].nl);
+    }
+    return state;
+}
+
+/*
+ * Cancels win's job (if any). A finished job is joined,
+ * while a still running one is abandoned, as it may be stuck
+ * (eg: on a hung mount): it will free itself when it returns.
+ */
+void stop_listing(int win) {
+    cancel_job(ps[win].job);
+    ps[win].job = NULL;
+}
+
+void cancel_job(struct dir_job *job) {
+    if (job) {
+        job->stop = 1;
+        pthread_mutex_lock(&job->lock);
+        if (job->state != LOAD_DONE) {
+            job->state = LOAD_ABANDONED;
+            pthread_mutex_unlock(&job->lock);
+            pthread_detach(job->th);
+        } else {
+            pthread_mutex_unlock(&job->lock);
+            if (job->th) {
+                pthread_join(job->th, NULL);
+            }
+            free_job(job);
+        }
+    }
+}
+
+static struct dir_job *new_job(const char *path, int show_hidden, int sorting_index, int k) {
+    struct dir_job *job;
+    pthread_condattr_t attr;
+
+    if (!(job = calloc(1, sizeof(struct dir_job)))) {
+        quit = MEM_ERR_QUIT;
+        ERROR("could not malloc.");
+        return NULL;
+    }
+    init_list(&job->list, path);
+    init_list(&job->partial, path);
+    job->inot.fd = -1;
+    job->inot.wd = -1;
+    job->show_hidden = show_hidden;
+    job->k = k;
+    job->sorting_index = sorting_index;
+    job->state = LOAD_RUNNING;
+    job->taken = LOAD_RUNNING;
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&job->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return job;
+}
+
+static void *dir_job_thread(void *x) {
+    struct dir_job *job = (struct dir_job *)x;
+
+    // under job lock: adopt_job may be restoring priority right now
+    pthread_mutex_lock(&job->lock);
+    if (job->prefetch) {
+        job->tid = syscall(SYS_gettid);
+        set_io_priority(job->tid, 1);
+    }
+    pthread_mutex_unlock(&job->lock);
+    load_dir(job);
+    return NULL;
+}
+
+/*
+ * Moves thread tid to idle I/O class (it only gets disk time nobody else wants)
+ * while prefetching, or back to default best effort class.
+ */
+static void set_io_priority(pid_t tid, int prefetch) {
+    int prio = prefetch ? IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0) : IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, 4);
+
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, prio);
+}
+
+/*
+ * Reads the dir with big getdents64 buffers.
+ * If it has more than LOADER_SYNC_MAX entries, entries read until now are stat'ed
+ * and only their first k are sorted, so that they can be printed immediately.
+ * Then the whole dir is stat'ed and sorted.
+ * If dir could not be (fully) read, job error is set and its stamp is cleared.
+ */
+static void load_dir(struct dir_job *job) {
+    char *buf = NULL;
+    int fd, r = 0;
+
+    // watch is set up before dir is read, not to miss any change
+    if ((job->inot.fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK)) != -1
+        && (job->inot.wd = inotify_add_watch(job->inot.fd, job->list.prefix, INOTIFY_MASK)) == -1) {
+        close(job->inot.fd);
+        job->inot.fd = -1;
+    }
+    if ((fd = open(job->list.prefix, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) != -1) {
+        struct stat st;
+        
+        // taken before reading: any later change makes list look stale
+        if (fstat(fd, &st) == 0) {
+            make_stamp(&st, &job->stamp);
+        }
+        job->opened = 1;
+        if (publish(job, LOAD_STAMPED) == -1) {
+            job->stop = 1;
+        }
+        if ((buf = malloc(DENTS_BUF_SIZE))) {
+            while (!job->stop && (r = read_dents(fd, buf, &job->list)) > 0 && !over_budget(job) && job->list.num < LOADER_SYNC_MAX);
+            if (r == -1) {
+                job->error = errno;
+            }
+            if (r > 0 && !job->stop && !job->prefetch && copy_list(&job->partial, &job->list) == 0) {
+                stat_list(&job->partial, &job->stop);
+                filter_list(&job->partial, job->show_hidden);
+                partial_sort(&job->partial, job->k, sorting_func[job->sorting_index]);
+                if (publish(job, LOAD_PARTIAL) == -1) {
+                    job->stop = 1;
+                }
+            }
+            while (r > 0 && !job->stop && (r = read_dents(fd, buf, &job->list)) > 0 && !over_budget(job));
+            if (r == -1 && !job->error) {
+                job->error = errno;
+            }
+            free(buf);
+        } else {
+            job->error = ENOMEM;
+            WARN("could not malloc dir job buffer.");
+        }
+        close(fd);
+    } else {
+        job->error = errno;
+    }
+    if (job->error) {
+        memset(&job->stamp, 0, sizeof(job->stamp));
+    }
+    stat_list(&job->list, &job->stop);
+    filter_list(&job->list, job->show_hidden);
+    sort_list(&job->list, job->sorting_index, &job->stop);
+    if (publish(job, LOAD_DONE) == -1) {
+        free_job(job);
+    }
+}
+
+/*
+ * Wakes up main thread (both if it is waiting in wait_listing or in main_poll).
+ * Returns -1 if job has been abandoned: nobody will take its lists.
+ */
+static int publish(struct dir_job *job, int state) {
+    pthread_mutex_lock(&job->lock);
+    if (job->state == LOAD_ABANDONED) {
+        pthread_mutex_unlock(&job->lock);
+        return -1;
+    }
+    job->state = state;
+    pthread_cond_signal(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+    eventfd_write(loader_fd, 1);
+    return 0;
+}
+
+/*
+ * Stops a prefetch job whose list grew over its max_bytes.
+ */
+static int over_budget(struct dir_job *job) {
+    if (job->max_bytes && list_bytes(&job->list) > job->max_bytes) {
+        pthread_mutex_lock(&job->lock);
+        if (job->max_bytes) {
+            job->stop = 1;
+        }
+        pthread_mutex_unlock(&job->lock);
+    }
+    return job->stop;
+}
+
+static void free_job(struct dir_job *job) {
+    if (job->inot.fd != -1) {
+        close(job->inot.fd);
+    }
+    free_list(&job->partial);
+    free_list(&job->list);
+    pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->cond);
+    free(job);
+}
+
+/*
+ * Reads a buffer of dir entries from fd, and adds them to l (but '.').
+ * Dotfiles are added too: filter_list will hide them if needed.
+ * Returns number of bytes read: 0 at the end of dir, -1 on error (with errno set).
+ */
+static int read_dents(int fd, char *buf, struct file_list *l) {
+    long len = syscall(SYS_getdents64, fd, buf, DENTS_BUF_SIZE);
+
+    for (long pos = 0; pos < len && !quit; ) {
+        struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + pos);
+        if (strcmp(d->d_name, ".")) {
+            int i = add_to_list(l, d->d_name, d->d_type);
+            if (i == -1) {
+                errno = ENOMEM;
+                return -1;
+            }
+            l->entries[i].ino = d->d_ino;
+        }
+        pos += d->d_reclen;
+    }
+    return len;
+}
+
+static int copy_list(struct file_list *dst, const struct file_list *src) {
+    for (int i = 0; i < src->num; i++) {
+        int j = add_to_list(dst, list_name(src, i), src->entries[i].d_type);
+        if (j == -1) {
+            return -1;
+        }
+        dst->entries[j].ino = src->entries[i].ino;
+    }
+    return 0;
+}
+
+/*
+ * Moves the k smallest entries (according to sort_func) at the top of l, sorted;
+ * order of the others is undefined.
+ * A max-heap of the best k entries is kept while scanning the list.
+ */
+static void partial_sort(struct file_list *l, int k, int (*sort_func)(const void *, const void *, void *)) {
+    struct file_entry tmp;
+
+    if (k < 1) {
+        k = 1;
+    }
+    if (k < l->num) {
+        for (int i = k / 2 - 1; i >= 0; i--) {
+            sift_down(l, i, k, sort_func);
+        }
+        for (int i = k; i < l->num; i++) {
+            if (sort_func(&l->entries[i], &l->entries[0], l) < 0) {
+                tmp = l->entries[i];
+                l->entries[i] = l->entries[0];
+                l->entries[0] = tmp;
+                sift_down(l, 0, k, sort_func);
+            }
+        }
+    } else {
+        k = l->num;
+    }
+    qsort_r(l->entries, k, sizeof(struct file_entry), sort_func, l);
+}
+
+static void sift_down(struct file_list *l, int i, int n, int (*sort_func)(const void *, const void *, void *)) {
+    struct file_entry *e = l->entries, tmp;
+
+    for (;;) {
+        int max = i, child = 2 * i + 1;
+
+        if (child < n && sort_func(&e[child], &e[max], l) > 0) {
+            max = child;
+        }
+        if (child + 1 < n && sort_func(&e[child + 1], &e[max], l) > 0) {
+            max = child + 1;
+        }
+        if (max == i) {
+            return;
+        }
+        tmp = e[i];
+        e[i] = e[max];
+        e[max] = tmp;
+        i = max;
+    }
+}
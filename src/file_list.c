@@ -0,0 +1,1029 @@
+#include "../inc/file_list.h"
+
+static int reserve_list(struct file_list *l, int num, size_t arena_len);
+static void release_name(struct file_list *l, int i);
+static void compact_arena(struct file_list *l);
+static int build_hash(struct file_list *l);
+static void hash_entry(struct file_list *l, int i);
+static void rehash_moved(struct file_list *l, int from, int to);
+static void drop_hash(struct file_list *l);
+static int build_index(struct file_list *l);
+static int index_lower_bound(const struct file_list *l, const char *name, int n);
+static int index_pos(const struct file_list *l, int i);
+static void index_insert(struct file_list *l, int i);
+static int index_remove(struct file_list *l, int i);
+static void remap_index(struct file_list *l, int old_num, const int *moved, int *added_pos, int num_added);
+static void drop_index(struct file_list *l);
+static int count_before(struct file_list *l, const struct file_entry *e, const struct file_entry *sorted, int n,
+                        int (*sort_func)(const void *, const void *, void *));
+static void stat_entry(struct file_entry *e, int dirfd, const char *name);
+static int inode_sort(const void *i1, const void *i2, void *l);
+static int index_namesort(const void *i1, const void *i2, void *l);
+static void *stat_thread(void *x);
+static void stat_parallel(struct file_list *l, int *order, int dirfd, const volatile int *stop);
+#ifdef LIBURING_PRESENT
+static int stat_uring(struct file_list *l, int *order, int dirfd, const volatile int *stop);
+static int uring_has_statx(struct io_uring *ring);
+static void reap_statx(struct file_entry *e, int res, const struct statx *stx);
+#endif
+
+/*
+ * Shared by stat threads: each one takes next entry
+ * (in inode order) until the list is over.
+ */
+struct stat_job {
+    struct file_list *l;
+    const int *order;
+    int dirfd;
+    int next;
+    const volatile int *stop;
+};
+
+/*
+ * Resets a list, setting the directory its names are relative to.
+ * A '/' is appended to prefix (if not already there),
+ * so that a fullpath is just prefix + name.
+ * An empty prefix means names are already fullpaths.
+ */
+void init_list(struct file_list *l, const char *prefix) {
+    memset(l, 0, sizeof(struct file_list));
+    if (prefix && strlen(prefix)) {
+        strncpy(l->prefix, prefix, PATH_MAX - 1);
+        l->prefix_len = strlen(l->prefix);
+        if (l->prefix[l->prefix_len - 1] != '/') {
+            l->prefix[l->prefix_len++] = '/';
+        }
+    }
+}
+
+/*
+ * Makes room for num entries, and for arena_len bytes of names in the arena,
+ * doubling both arrays until they are big enough.
+ */
+static int reserve_list(struct file_list *l, int num, size_t arena_len) {
+    if (num > l->size) {
+        int size = l->size ? 2 * l->size : 16;
+        while (size < num) {
+            size *= 2;
+        }
+        struct file_entry *tmp = realloc(l->entries, size * sizeof(struct file_entry));
+        if (!tmp) {
+            goto error;
+        }
+        l->entries = tmp;
+        l->size = size;
+        if (l->name_index) {
+            int *idx = realloc(l->name_index, size * sizeof(int));
+            
+            if (idx) {
+                l->name_index = idx;
+            } else {
+                // not a problem: it will be built again by next lookup
+                drop_index(l);
+            }
+        }
+    }
+    if (arena_len > l->arena_size) {
+        size_t size = l->arena_size ? 2 * l->arena_size : BUFF_SIZE;
+        while (size < arena_len) {
+            size *= 2;
+        }
+        char *tmp = realloc(l->arena, size);
+        if (!tmp) {
+            goto error;
+        }
+        l->arena = tmp;
+        l->arena_size = size;
+    }
+    return 0;
+
+error:
+    quit = MEM_ERR_QUIT;
+    ERROR("could not realloc. Leaving.");
+    return -1;
+}
+
+/*
+ * Appends name to the list; returns its index, or -1 on error.
+ */
+int add_to_list(struct file_list *l, const char *name, unsigned char d_type) {
+    size_t len = strlen(name);
+    
+    if (len > PATH_MAX - l->prefix_len) {
+        len = PATH_MAX - l->prefix_len;
+    }
+    if (reserve_list(l, ALL_ENTRIES(l) + 1, l->arena_len + len + 1) == -1) {
+        return -1;
+    }
+    // keep hash load factor under 3/4: it will be built again, bigger, by next lookup
+    if (l->hash && 4 * (ALL_ENTRIES(l) + 1) > 3 * l->hash_size) {
+        drop_hash(l);
+    }
+    // make room at the end of listed entries, moving first hidden one to the end
+    if (l->num_hidden) {
+        l->entries[ALL_ENTRIES(l)] = l->entries[l->num];
+        if (l->hash) {
+            rehash_moved(l, l->num, ALL_ENTRIES(l));
+        }
+    }
+    struct file_entry *e = &l->entries[l->num];
+    e->name_off = l->arena_len;
+    e->name_len = len;
+    e->d_type = d_type;
+    e->ino = 0;
+    e->size = 0;
+    e->mtime = 0;
+    e->mode = 0;
+    e->stat_state = STAT_MISSING;
+    e->hidden = name[0] == '.' && name[1] != '.';
+    e->selected = 0;
+    memcpy(l->arena + l->arena_len, name, len);
+    l->arena[l->arena_len + len] = '\0';
+    l->arena_len += len + 1;
+    if (l->hash) {
+        hash_entry(l, l->num);
+    }
+    if (l->name_index) {
+        index_insert(l, l->num);
+    }
+    return l->num++;
+}
+
+/*
+ * Removes i-th entry. Its name is left in the arena as a hole,
+ * that will be reclaimed once holes take more than half of the arena.
+ */
+void remove_from_list(struct file_list *l, int i) {
+    drop_hash(l);
+    if (l->name_index && i < l->num && !index_remove(l, i)) {
+        // following entries are moved back by one
+        for (int k = 0; k < l->num - 1; k++) {
+            if (l->name_index[k] > i) {
+                l->name_index[k]--;
+            }
+        }
+    }
+    release_name(l, i);
+    memmove(&l->entries[i], &l->entries[i + 1], (ALL_ENTRIES(l) - 1 - i) * sizeof(struct file_entry));
+    if (i < l->num) {
+        l->num--;
+    } else {
+        l->num_hidden--;
+    }
+    if (!ALL_ENTRIES(l)) {
+        l->arena_len = 0;
+        l->holes = 0;
+    } else if (l->holes > l->arena_len / 2) {
+        compact_arena(l);
+    }
+}
+
+/*
+ * Removes i-th listed entry in O(1), moving last listed entry in its place
+ * (and last hidden one in place of that), so list order is not kept.
+ * Returns old index of the entry moved to i, or -1 if none was moved.
+ */
+int swap_remove_from_list(struct file_list *l, int i) {
+    int last = l->num - 1, moved = last != i ? last : -1;
+
+    drop_hash(l);
+    if (l->name_index) {
+        int pos = moved != -1 ? index_pos(l, last) : 0;
+        
+        if (pos == -1) {
+            drop_index(l);
+        } else if (!index_remove(l, i) && moved != -1) {
+            // last entry's position may have moved back by one while i was removed
+            if (pos > 0 && l->name_index[pos - 1] == last) {
+                pos--;
+            }
+            l->name_index[pos] = i;
+        }
+    }
+    release_name(l, i);
+    l->entries[i] = l->entries[last];
+    if (l->num_hidden) {
+        l->entries[last] = l->entries[ALL_ENTRIES(l) - 1];
+    }
+    l->num--;
+    if (!ALL_ENTRIES(l)) {
+        l->arena_len = 0;
+        l->holes = 0;
+    } else if (l->holes > l->arena_len / 2) {
+        compact_arena(l);
+    }
+    return moved;
+}
+
+/*
+ * Name of i-th entry becomes a hole in the arena.
+ */
+static void release_name(struct file_list *l, int i) {
+    l->holes += l->entries[i].name_len + 1;
+}
+
+static void compact_arena(struct file_list *l) {
+    char *arena = malloc(l->arena_size);
+    size_t len = 0;
+    
+    if (!arena) {
+        // not a problem: we will just keep the holes.
+        return;
+    }
+    for (int i = 0; i < ALL_ENTRIES(l); i++) {
+        memcpy(arena + len, l->arena + l->entries[i].name_off, l->entries[i].name_len + 1);
+        l->entries[i].name_off = len;
+        len += l->entries[i].name_len + 1;
+    }
+    free(l->arena);
+    l->arena = arena;
+    l->arena_len = len;
+    l->holes = 0;
+}
+
+/*
+ * Searches name among every entry of l (hidden ones too), through l's hash
+ * (built here if needed); if it cannot be built, every entry is compared.
+ * Returns its index, or -1.
+ */
+int find_in_list(struct file_list *l, const char *name) {
+    size_t len = strlen(name);
+    
+    if (!ALL_ENTRIES(l)) {
+        return -1;
+    }
+    if (l->hash || build_hash(l) == 0) {
+        const int mask = l->hash_size - 1;
+        
+        for (int s = str_hash(name) & mask; l->hash[s] != -1; s = (s + 1) & mask) {
+            int i = l->hash[s];
+            if (l->entries[i].name_len == len && !memcmp(list_name(l, i), name, len)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+    for (int i = 0; i < ALL_ENTRIES(l); i++) {
+        if (l->entries[i].name_len == len && !memcmp(list_name(l, i), name, len)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * FNV-1a hash of str.
+ */
+uint64_t str_hash(const char *str) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (; *str; str++) {
+        hash = (hash ^ (unsigned char)*str) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * Builds l's hash, with at least twice as many slots as entries (and at least LIST_HASH_MIN).
+ * Returns -1 if it could not be allocated.
+ */
+static int build_hash(struct file_list *l) {
+    int size = LIST_HASH_MIN;
+    
+    while (size < 2 * ALL_ENTRIES(l)) {
+        size *= 2;
+    }
+    if (!(l->hash = malloc(size * sizeof(int)))) {
+        return -1;
+    }
+    l->hash_size = size;
+    memset(l->hash, -1, size * sizeof(int));
+    for (int i = 0; i < ALL_ENTRIES(l); i++) {
+        hash_entry(l, i);
+    }
+    return 0;
+}
+
+/*
+ * Adds i-th entry to l's hash (linear probing).
+ */
+static void hash_entry(struct file_list *l, int i) {
+    const int mask = l->hash_size - 1;
+    int s = str_hash(list_name(l, i)) & mask;
+    
+    while (l->hash[s] != -1) {
+        s = (s + 1) & mask;
+    }
+    l->hash[s] = i;
+}
+
+/*
+ * Entry "from" has been moved to "to": updates its slot.
+ */
+static void rehash_moved(struct file_list *l, int from, int to) {
+    const int mask = l->hash_size - 1;
+    int s = str_hash(list_name(l, to)) & mask;
+    
+    while (l->hash[s] != from) {
+        s = (s + 1) & mask;
+    }
+    l->hash[s] = to;
+}
+
+static void drop_hash(struct file_list *l) {
+    free(l->hash);
+    l->hash = NULL;
+    l->hash_size = 0;
+}
+
+/*
+ * Brings sorted list l up to date with changes (names of changed files, relative to l's dir):
+ * every changed entry is removed, and files that still exist (stat'ed all together
+ * through stat_list) are inserted again at their sorted position, or among hidden entries
+ * if they're dotfiles and !show_hidden.
+ * Removed entries are compacted away with a single pass, then sorted new ones
+ * are merged with listed ones backwards, in place.
+ * Each index in track (of a listed entry) is moved to the position its entry has now
+ * (or would have, if it was removed).
+ * Returns the index of first changed listed entry (last one in *last), or -1 if none changed.
+ */
+int merge_changes(struct file_list *l, struct file_list *changes, int show_hidden,
+                  int (*sort_func)(const void *, const void *, void *), int *track, int num_track, int *last) {
+    struct file_list fresh;
+    struct file_entry *added = NULL;
+    char *removed = NULL;
+    int *moved = NULL, old_num = l->num;
+    int num_added = 0, num_hidden_added = 0, first = -1, first_removed = -1, last_removed = -1;
+    int num_removed = 0, survived = 0, hidden_survived = 0, j;
+    
+    *last = -1;
+    init_list(&fresh, l->prefix);
+    for (int i = 0; i < ALL_ENTRIES(changes); i++) {
+        const char *name = list_name(changes, i);
+        if (find_in_list(&fresh, name) == -1 && add_to_list(&fresh, name, DT_UNKNOWN) == -1) {
+            goto end;
+        }
+    }
+    if (!fresh.num) {
+        goto end;
+    }
+    stat_list(&fresh, NULL);
+    if (!(removed = calloc(ALL_ENTRIES(l) + 1, sizeof(char))) || !(added = malloc(fresh.num * sizeof(struct file_entry)))
+        || reserve_list(l, ALL_ENTRIES(l) + fresh.num, l->arena_len + fresh.arena_len) == -1) {
+        quit = MEM_ERR_QUIT;
+        ERROR("could not malloc.");
+        goto end;
+    }
+    // new entries (listed ones at the beginning, hidden ones at the end of added) get their names copied to l's arena
+    for (int i = 0; i < fresh.num; i++) {
+        int k = find_in_list(l, list_name(&fresh, i));
+        
+        if (k != -1) {
+            removed[k] = 1;
+            if (k < l->num) {
+                num_removed++;
+                if (first_removed == -1 || k < first_removed) {
+                    first_removed = k;
+                }
+                if (k > last_removed) {
+                    last_removed = k;
+                }
+            }
+        }
+        if (fresh.entries[i].stat_state == STAT_CACHED) {
+            struct file_entry *e = fresh.entries[i].hidden && !show_hidden ?
+                                   &added[fresh.num - 1 - num_hidden_added++] : &added[num_added++];
+            
+            *e = fresh.entries[i];
+            e->name_off = l->arena_len;
+            memcpy(l->arena + l->arena_len, list_name(&fresh, i), e->name_len + 1);
+            l->arena_len += e->name_len + 1;
+        }
+    }
+    qsort_r(added, num_added, sizeof(struct file_entry), sort_func, l);
+    // where removed and tracked entries are (or would be) once merged: computed while old entries are still there
+    if (first_removed != -1) {
+        first = first_removed + count_before(l, &l->entries[first_removed], added, num_added, sort_func);
+        *last = last_removed - (num_removed - 1) + count_before(l, &l->entries[last_removed], added, num_added, sort_func);
+    }
+    for (int k = 0; k < num_track; k++) {
+        if (track[k] >= 0 && track[k] < l->num) {
+            int before = count_before(l, &l->entries[track[k]], added, num_added, sort_func);
+            int removed_before = 0;
+            
+            for (int i = 0; i < track[k]; i++) {
+                removed_before += removed[i];
+            }
+            track[k] += before - removed_before;
+        }
+    }
+    // name_index is remapped afterwards: moved[i] is where i-th listed entry is after compaction (-1 if removed),
+    // followed by where each compacted entry ends up after merge and by positions of new listed entries
+    if (l->name_index && !(moved = malloc((2 * old_num + num_added) * sizeof(int)))) {
+        drop_index(l);
+    }
+    // compact survivors: listed ones first, then hidden ones
+    for (int i = 0; i < ALL_ENTRIES(l); i++) {
+        if (removed[i]) {
+            release_name(l, i);
+            if (moved && i < l->num) {
+                moved[i] = -1;
+            }
+        } else if (i < l->num) {
+            if (moved) {
+                moved[i] = survived;
+                moved[old_num + survived] = survived;
+            }
+            l->entries[survived++] = l->entries[i];
+        } else {
+            l->entries[survived + hidden_survived++] = l->entries[i];
+        }
+    }
+    // hidden survivors go after merged listed entries, followed by new hidden ones
+    memmove(&l->entries[survived + num_added], &l->entries[survived], hidden_survived * sizeof(struct file_entry));
+    memcpy(&l->entries[survived + num_added + hidden_survived], &added[fresh.num - num_hidden_added],
+           num_hidden_added * sizeof(struct file_entry));
+    // on equal keys, old entries stay first
+    j = survived - 1;
+    for (int k = num_added - 1, pos = survived + num_added - 1; k >= 0; pos--) {
+        if (j >= 0 && sort_func(&l->entries[j], &added[k], l) > 0) {
+            if (moved) {
+                moved[old_num + j] = pos;
+            }
+            l->entries[pos] = l->entries[j--];
+        } else {
+            if (moved) {
+                moved[2 * old_num + k] = pos;
+            }
+            l->entries[pos] = added[k--];
+            if (pos > *last) {
+                *last = pos;
+            }
+            if (first == -1 || pos < first) {
+                first = pos;
+            }
+        }
+    }
+    l->num = survived + num_added;
+    l->num_hidden = hidden_survived + num_hidden_added;
+    drop_hash(l);
+    if (moved) {
+        remap_index(l, old_num, moved, &moved[2 * old_num], num_added);
+    }
+    if (!ALL_ENTRIES(l)) {
+        l->arena_len = 0;
+        l->holes = 0;
+    } else if (l->holes > l->arena_len / 2) {
+        compact_arena(l);
+    }
+
+end:
+    free(removed);
+    free(moved);
+    free(added);
+    free_list(&fresh);
+    return first;
+}
+
+/*
+ * Number of entries of sorted array that would be placed before e (they sort strictly before it).
+ */
+static int count_before(struct file_list *l, const struct file_entry *e, const struct file_entry *sorted, int n,
+                        int (*sort_func)(const void *, const void *, void *)) {
+    int lo = 0, hi = n;
+    
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (sort_func(&sorted[mid], e, l) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ * Returns index of first listed entry (from start_idx on) whose name starts with prefix, or -1.
+ * Names starting with prefix are contiguous in name_index: they're found with two binary searches
+ * (lower and upper bound of prefix), then only them are checked.
+ */
+int find_prefix(struct file_list *l, const char *prefix, int start_idx) {
+    size_t len = strlen(prefix);
+    int lo, hi, found = -1;
+    
+    if (start_idx >= l->num || (!l->name_index && build_index(l) == -1)) {
+        return -1;
+    }
+    lo = index_lower_bound(l, prefix, l->num);
+    // matches end at first name whose first len chars compare greater than prefix
+    hi = l->num;
+    for (int a = lo; a < hi; ) {
+        int mid = (a + hi) / 2;
+        if (!strncmp(list_name(l, l->name_index[mid]), prefix, len)) {
+            a = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (int i = lo; i < hi; i++) {
+        int idx = l->name_index[i];
+        if (idx >= start_idx && (found == -1 || idx < found)) {
+            found = idx;
+        }
+    }
+    return found;
+}
+
+/*
+ * Drops name_index and hash: needed as soon as every entry is moved.
+ */
+void drop_name_index(struct file_list *l) {
+    drop_index(l);
+    drop_hash(l);
+}
+
+static int build_index(struct file_list *l) {
+    if (!(l->name_index = malloc(l->size * sizeof(int)))) {
+        quit = MEM_ERR_QUIT;
+        ERROR("could not malloc.");
+        return -1;
+    }
+    for (int i = 0; i < l->num; i++) {
+        l->name_index[i] = i;
+    }
+    qsort_r(l->name_index, l->num, sizeof(int), index_namesort, l);
+    return 0;
+}
+
+/*
+ * First of n name_index positions whose name is not less than name.
+ */
+static int index_lower_bound(const struct file_list *l, const char *name, int n) {
+    int lo = 0, hi = n;
+    
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(list_name(l, l->name_index[mid]), name) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ * Position of i-th listed entry inside name_index, or -1.
+ */
+static int index_pos(const struct file_list *l, int i) {
+    const char *name = list_name(l, i);
+    
+    for (int pos = index_lower_bound(l, name, l->num);
+         pos < l->num && !strcmp(list_name(l, l->name_index[pos]), name); pos++) {
+        if (l->name_index[pos] == i) {
+            return pos;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Inserts i-th entry, just appended to listed ones, at its sorted position.
+ */
+static void index_insert(struct file_list *l, int i) {
+    int pos = index_lower_bound(l, list_name(l, i), i);
+    
+    memmove(&l->name_index[pos + 1], &l->name_index[pos], (i - pos) * sizeof(int));
+    l->name_index[pos] = i;
+}
+
+/*
+ * Removes i-th listed entry from name_index (other indexes are not changed).
+ * Returns -1 if it was not there: then name_index is dropped.
+ */
+static int index_remove(struct file_list *l, int i) {
+    int pos = index_pos(l, i);
+    
+    if (pos == -1) {
+        drop_index(l);
+        return -1;
+    }
+    memmove(&l->name_index[pos], &l->name_index[pos + 1], (l->num - 1 - pos) * sizeof(int));
+    return 0;
+}
+
+/*
+ * Brings name_index up to date once merge_changes merged new entries:
+ * old listed entry i is now at moved[old_num + moved[i]] (moved[i] is -1 if it was removed),
+ * new listed ones are at added_pos. Survivors keep their order, so only new ones are sorted,
+ * then each of them is put in place with a binary search, going backwards.
+ */
+static void remap_index(struct file_list *l, int old_num, const int *moved, int *added_pos, int num_added) {
+    int m = 0;
+    
+    for (int p = 0; p < old_num; p++) {
+        int i = l->name_index[p];
+        if (moved[i] != -1) {
+            l->name_index[m++] = moved[old_num + moved[i]];
+        }
+    }
+    qsort_r(added_pos, num_added, sizeof(int), index_namesort, l);
+    for (int k = num_added - 1; k >= 0; k--) {
+        int pos = index_lower_bound(l, list_name(l, added_pos[k]), m);
+        
+        memmove(&l->name_index[pos + k + 1], &l->name_index[pos], (m - pos) * sizeof(int));
+        l->name_index[pos + k] = added_pos[k];
+        m = pos;
+    }
+}
+
+static void drop_index(struct file_list *l) {
+    free(l->name_index);
+    l->name_index = NULL;
+}
+
+static int index_namesort(const void *i1, const void *i2, void *l) {
+    return strcmp(list_name(l, *(const int *)i1), list_name(l, *(const int *)i2));
+}
+
+/*
+ * Hides (moving them after listed ones) or shows again hidden entries.
+ * Hiding keeps listed entries order; shown entries are appended,
+ * so list needs to be sorted again.
+ * Returns -1 if list could not be filtered.
+ */
+int filter_list(struct file_list *l, int show_hidden) {
+    drop_name_index(l);
+    if (show_hidden) {
+        l->num += l->num_hidden;
+        l->num_hidden = 0;
+    } else {
+        struct file_entry *hidden;
+        int j = 0, k = 0;
+        
+        if (!(hidden = malloc(ALL_ENTRIES(l) * sizeof(struct file_entry)))) {
+            quit = MEM_ERR_QUIT;
+            ERROR("could not malloc.");
+            return -1;
+        }
+        for (int i = 0; i < l->num; i++) {
+            if (l->entries[i].hidden) {
+                hidden[k++] = l->entries[i];
+            } else {
+                l->entries[j++] = l->entries[i];
+            }
+        }
+        memcpy(&l->entries[j], hidden, k * sizeof(struct file_entry));
+        free(hidden);
+        l->num = j;
+        l->num_hidden += k;
+    }
+    return 0;
+}
+
+/*
+ * Makes dst a copy of src (name index and hash excluded).
+ */
+int dup_list(struct file_list *dst, const struct file_list *src) {
+    *dst = *src;
+    dst->name_index = NULL;
+    dst->hash = NULL;
+    dst->hash_size = 0;
+    dst->entries = malloc(src->size * sizeof(struct file_entry));
+    dst->arena = malloc(src->arena_size);
+    if ((src->size && !dst->entries) || (src->arena_size && !dst->arena)) {
+        free_list(dst);
+        quit = MEM_ERR_QUIT;
+        ERROR("could not malloc.");
+        return -1;
+    }
+    memcpy(dst->entries, src->entries, ALL_ENTRIES(src) * sizeof(struct file_entry));
+    memcpy(dst->arena, src->arena, src->arena_len);
+    return 0;
+}
+
+/*
+ * Heap memory used by l's entries and names.
+ */
+size_t list_bytes(const struct file_list *l) {
+    return l->size * sizeof(struct file_entry) + l->arena_size;
+}
+
+void free_list(struct file_list *l) {
+    drop_index(l);
+    free(l->hash);
+    free(l->entries);
+    free(l->arena);
+    init_list(l, NULL);
+}
+
+char *list_name(const struct file_list *l, int i) {
+    return l->arena + l->entries[i].name_off;
+}
+
+/*
+ * Writes i-th entry fullpath inside path (at least PATH_MAX + 1 bytes).
+ */
+char *list_fullpath(const struct file_list *l, int i, char *path) {
+    memcpy(path, l->prefix, l->prefix_len);
+    memcpy(path + l->prefix_len, list_name(l, i), l->entries[i].name_len + 1);
+    return path;
+}
+
+/*
+ * Searches fullpath "name" inside l, starting from start_idx.
+ * If len != -1, only first len chars are compared.
+ * Prefix is checked only once, then only the names are compared.
+ */
+int is_present(const char *name, const struct file_list *l, int len, int start_idx) {
+    int cmp;
+    
+    if (len != -1 && len <= (int)l->prefix_len) {
+        if (strncmp(name, l->prefix, len) || start_idx >= l->num) {
+            return -1;
+        }
+        return start_idx;
+    }
+    if (strncmp(name, l->prefix, l->prefix_len)) {
+        return -1;
+    }
+    name += l->prefix_len;
+    if (len != -1) {
+        len -= l->prefix_len;
+    }
+    for (int i = start_idx; i < l->num; i++) {
+        if (len != -1) {
+            cmp = strncmp(list_name(l, i), name, len);
+        } else {
+            cmp = strcmp(list_name(l, i), name);
+        }
+        if (!cmp) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Caches type, mode, size and mtime of an entry with a single
+ * lstat-like call (statx asking only for the needed fields, where available).
+ * If dirent did not know file type, fill it from mode.
+ */
+static void stat_entry(struct file_entry *e, int dirfd, const char *name) {
+#ifdef STATX_TYPE
+    struct statx stx;
+    
+    if (statx(dirfd, name, AT_SYMLINK_NOFOLLOW, STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO, &stx) == 0) {
+        e->ino = stx.stx_ino;
+        e->mode = stx.stx_mode;
+        e->size = stx.stx_size;
+        e->mtime = stx.stx_mtime.tv_sec;
+#else
+    struct stat st;
+    
+    if (fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        e->ino = st.st_ino;
+        e->mode = st.st_mode;
+        e->size = st.st_size;
+        e->mtime = st.st_mtime;
+#endif
+        e->stat_state = STAT_CACHED;
+        if (e->d_type == DT_UNKNOWN) {
+            e->d_type = IFTODT(e->mode);
+        }
+    } else {
+        e->stat_state = STAT_FAILED;
+    }
+}
+
+/*
+ * (Re)caches stats of every entry of the list: one stat per file,
+ * relative to prefix dir fd (names are fullpaths if there's no prefix).
+ * Small lists are stat'ed serially; for bigger ones, entries are visited
+ * in inode order (less seeks on cold cache) and stats are batched
+ * through io_uring, or spread across some threads.
+ * If stop is not NULL, stats are interrupted as soon as *stop is set.
+ */
+void stat_list(struct file_list *l, const volatile int *stop) {
+    int fd = AT_FDCWD, *order;
+    
+    if (l->prefix_len && (fd = open(l->prefix, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+        for (int i = 0; i < ALL_ENTRIES(l); i++) {
+            l->entries[i].stat_state = STAT_FAILED;
+        }
+        return;
+    }
+    if (ALL_ENTRIES(l) < STAT_PARALLEL_MIN || !(order = malloc(ALL_ENTRIES(l) * sizeof(int)))) {
+        for (int i = 0; i < ALL_ENTRIES(l) && !STAT_STOPPED(stop); i++) {
+            stat_entry(&l->entries[i], fd, list_name(l, i));
+        }
+    } else {
+        for (int i = 0; i < ALL_ENTRIES(l); i++) {
+            order[i] = i;
+        }
+        qsort_r(order, ALL_ENTRIES(l), sizeof(int), inode_sort, l);
+#ifdef LIBURING_PRESENT
+        if (stat_uring(l, order, fd, stop) == -1) {
+            stat_parallel(l, order, fd, stop);
+        }
+#else
+        stat_parallel(l, order, fd, stop);
+#endif
+        free(order);
+    }
+    if (fd != AT_FDCWD) {
+        close(fd);
+    }
+}
+
+static int inode_sort(const void *i1, const void *i2, void *l) {
+    const struct file_entry *e = ((struct file_list *)l)->entries;
+    ino_t ino1 = e[*(const int *)i1].ino, ino2 = e[*(const int *)i2].ino;
+    
+    return (ino1 > ino2) - (ino1 < ino2);
+}
+
+static void *stat_thread(void *x) {
+    struct stat_job *job = (struct stat_job *)x;
+    int i;
+    
+    while (!STAT_STOPPED(job->stop) && (i = __sync_fetch_and_add(&job->next, 1)) < ALL_ENTRIES(job->l)) {
+        int idx = job->order[i];
+        stat_entry(&job->l->entries[idx], job->dirfd, list_name(job->l, idx));
+    }
+    return NULL;
+}
+
+/*
+ * Spreads stats across up to MAX_STAT_THREADS threads (current one included),
+ * one for each online cpu.
+ * Every thread writes different entries, so no lock is needed.
+ */
+static void stat_parallel(struct file_list *l, int *order, int dirfd, const volatile int *stop) {
+    pthread_t th[MAX_STAT_THREADS];
+    struct stat_job job = { .l = l, .order = order, .dirfd = dirfd, .next = 0, .stop = stop };
+    long num_th = sysconf(_SC_NPROCESSORS_ONLN);
+    int started = 0;
+    
+    if (num_th > MAX_STAT_THREADS) {
+        num_th = MAX_STAT_THREADS;
+    }
+    for (int i = 0; i < num_th - 1; i++) {
+        if (pthread_create(&th[started], NULL, stat_thread, &job) == 0) {
+            started++;
+        }
+    }
+    stat_thread(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(th[i], NULL);
+    }
+}
+
+#ifdef LIBURING_PRESENT
+/*
+ * Batches statx calls through io_uring, keeping up to STAT_URING_DEPTH
+ * of them in flight. Each slot of stx[] is owned by one in flight request
+ * (its index is the sqe user data).
+ * If ring breaks, every request in flight is reaped before stx is freed
+ * (if one cannot be reaped, stx is leaked, as kernel could still write it),
+ * and entries whose request was never submitted are stat'ed the usual way.
+ * Returns -1 if io_uring (or its statx opcode) is not available,
+ * so that caller can fallback to stat_parallel.
+ */
+static int stat_uring(struct file_list *l, int *order, int dirfd, const volatile int *stop) {
+    struct io_uring ring;
+    struct io_uring_cqe *cqe;
+    struct statx *stx;
+    int slot_entry[STAT_URING_DEPTH], free_slots[STAT_URING_DEPTH];
+    int num_free = STAT_URING_DEPTH, next = 0, in_flight = 0, queued = 0, ret;
+    const unsigned int mask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO;
+    
+    if (io_uring_queue_init(STAT_URING_DEPTH, &ring, 0) < 0) {
+        return -1;
+    }
+    if (!uring_has_statx(&ring) || !(stx = malloc(STAT_URING_DEPTH * sizeof(struct statx)))) {
+        io_uring_queue_exit(&ring);
+        return -1;
+    }
+    for (int i = 0; i < STAT_URING_DEPTH; i++) {
+        free_slots[i] = i;
+    }
+    for (int i = 0; i < ALL_ENTRIES(l); i++) {
+        l->entries[i].stat_state = STAT_MISSING;
+    }
+    // once stopped, no new request is queued, but in flight ones are still reaped
+    while (in_flight || queued || (next < ALL_ENTRIES(l) && !STAT_STOPPED(stop))) {
+        while (next < ALL_ENTRIES(l) && num_free && !STAT_STOPPED(stop)) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+            if (!sqe) {
+                break;
+            }
+            int slot = free_slots[--num_free];
+            slot_entry[slot] = order[next++];
+            io_uring_prep_statx(sqe, dirfd, list_name(l, slot_entry[slot]),
+                                AT_SYMLINK_NOFOLLOW, mask, &stx[slot]);
+            io_uring_sqe_set_data(sqe, (void *)(intptr_t)slot);
+            queued++;
+        }
+        if (queued) {
+            ret = io_uring_submit(&ring);
+            if (ret > 0) {
+                in_flight += ret;
+                queued -= ret;
+            } else if (ret != -EINTR && !in_flight) {
+                // nothing in flight whose completion could free kernel resources (-EAGAIN/-EBUSY): give up
+                break;
+            }
+        }
+        if (!in_flight) {
+            continue;
+        }
+        ret = io_uring_wait_cqe(&ring, &cqe);
+        if (ret == -EINTR) {
+            continue;
+        }
+        if (ret < 0) {
+            break;
+        }
+        do {
+            int slot = (int)(intptr_t)io_uring_cqe_get_data(cqe);
+            
+            reap_statx(&l->entries[slot_entry[slot]], cqe->res, &stx[slot]);
+            free_slots[num_free++] = slot;
+            in_flight--;
+            io_uring_cqe_seen(&ring, cqe);
+        } while (io_uring_peek_cqe(&ring, &cqe) == 0);
+    }
+    // ring broke: reap requests still in flight
+    while (in_flight && ((ret = io_uring_wait_cqe(&ring, &cqe)) == 0 || ret == -EINTR)) {
+        if (ret == 0) {
+            int slot = (int)(intptr_t)io_uring_cqe_get_data(cqe);
+            
+            reap_statx(&l->entries[slot_entry[slot]], cqe->res, &stx[slot]);
+            in_flight--;
+            io_uring_cqe_seen(&ring, cqe);
+        }
+    }
+    // requests never submitted (last queued ones, and following entries) are stat'ed the usual way
+    for (int i = next - queued; i < ALL_ENTRIES(l) && !STAT_STOPPED(stop); i++) {
+        stat_entry(&l->entries[order[i]], dirfd, list_name(l, order[i]));
+    }
+    io_uring_queue_exit(&ring);
+    if (!in_flight) {
+        free(stx);
+    }
+    return 0;
+}
+
+/*
+ * Kernels from 5.1 to 5.5 have io_uring but no statx opcode (every request would fail with -EINVAL).
+ * Ring is probed only once: result holds for every ring.
+ */
+static int uring_has_statx(struct io_uring *ring) {
+    static volatile int supported = -1;
+    
+    if (supported == -1) {
+        struct io_uring_probe *probe = io_uring_get_probe_ring(ring);
+        
+        // probing itself is only available since 5.6, as statx
+        supported = probe && io_uring_opcode_supported(probe, IORING_OP_STATX);
+        if (probe) {
+            io_uring_free_probe(probe);
+        }
+    }
+    return supported;
+}
+
+/*
+ * Caches stats of e from its statx request result.
+ */
+static void reap_statx(struct file_entry *e, int res, const struct statx *stx) {
+    if (res == 0) {
+        e->ino = stx->stx_ino;
+        e->mode = stx->stx_mode;
+        e->size = stx->stx_size;
+        e->mtime = stx->stx_mtime.tv_sec;
+        e->stat_state = STAT_CACHED;
+        if (e->d_type == DT_UNKNOWN) {
+            e->d_type = IFTODT(e->mode);
+        }
+    } else {
+        e->stat_state = STAT_FAILED;
+    }
+}
+#endif
+
+/*
+ * Returns i-th entry, caching its stats first if they are still missing.
+ */
+struct file_entry *list_stat(struct file_list *l, int i) {
+    struct file_entry *e = &l->entries[i];
+    
+    if (e->stat_state == STAT_MISSING) {
+        char path[PATH_MAX + 1];
+        
+        stat_entry(e, AT_FDCWD, list_fullpath(l, i, path));
+    }
+    return e;
+}
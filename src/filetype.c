@@ -0,0 +1,395 @@
+#include "../inc/filetype.h"
+
+/*
+ * LS_COLORS keys for file types and special permissions,
+ * in the order of ls_keys[].
+ */
+enum ls_key {LS_DI, LS_LN, LS_EX, LS_FI, LS_PI, LS_SO, LS_BD, LS_CD, LS_SU, LS_SG, LS_TW, LS_OW, LS_ST, NUM_LS_KEYS};
+
+struct ext_category {
+    const char *ext;
+    int category;
+};
+
+/*
+ * An LS_COLORS extension entry: folded extension (without leading dot) and its attributes.
+ */
+struct ls_ext {
+    char ext[MAX_EXT_LEN + 1];
+    attr_t attr;
+};
+
+static uint32_t ext_hash(const char *ext, size_t len);
+static int lookup_exts(const char *name, int (*lookup)(const char *ext, size_t len, void *res), void *res);
+static int category_lookup(const char *ext, size_t len, void *res);
+static int ls_lookup(const char *ext, size_t len, void *res);
+static void parse_ls_colors(const char *str);
+static void add_ls_ext(const char *ext, size_t len, attr_t attr);
+static attr_t sgr_to_attr(const char *sgr);
+static short color_pair(short fg, short bg);
+
+/*
+ * Perfect hash table of known extensions: EXT_HASH_SEED has been chosen so that
+ * no two of them share a slot (slot is top 8 bits of EXT_HASH_SEED * fnv1a(ext)).
+ * Adding an extension needs a new seed, and the table laid out again.
+ */
+#define EXT_HASH_SEED 0x37dbfu
+static const struct ext_category ext_table[EXT_TABLE_SIZE] = {
+    [0] = {"cs", SOURCE_CATEGORY},
+    [3] = {"zip", ARCHIVE_CATEGORY},
+    [5] = {"lha", ARCHIVE_CATEGORY},
+    [11] = {"tga", IMAGE_CATEGORY},
+    [15] = {"txz", ARCHIVE_CATEGORY},
+    [25] = {"c", SOURCE_CATEGORY},
+    [26] = {"pkg.tar.xz", PACKAGE_CATEGORY},
+    [37] = {"ico", IMAGE_CATEGORY},
+    [38] = {"rpm", PACKAGE_CATEGORY},
+    [39] = {"cxx", SOURCE_CATEGORY},
+    [42] = {"svg", IMAGE_CATEGORY},
+    [43] = {"gz", COMPRESSED_CATEGORY},
+    [45] = {"tlz", ARCHIVE_CATEGORY},
+    [47] = {"lz4", COMPRESSED_CATEGORY},
+    [48] = {"ts", SOURCE_CATEGORY},
+    [52] = {"hpp", SOURCE_CATEGORY},
+    [53] = {"tar.xz", ARCHIVE_CATEGORY},
+    [54] = {"hh", SOURCE_CATEGORY},
+    [59] = {"pgm", IMAGE_CATEGORY},
+    [60] = {"zst", COMPRESSED_CATEGORY},
+    [64] = {"tar.gz", ARCHIVE_CATEGORY},
+    [66] = {"xz", COMPRESSED_CATEGORY},
+    [67] = {"xbm", IMAGE_CATEGORY},
+    [71] = {"png", IMAGE_CATEGORY},
+    [72] = {"cc", SOURCE_CATEGORY},
+    [74] = {"z", COMPRESSED_CATEGORY},
+    [77] = {"jpeg", IMAGE_CATEGORY},
+    [81] = {"tif", IMAGE_CATEGORY},
+    [82] = {"lzma", COMPRESSED_CATEGORY},
+    [87] = {"tbz", ARCHIVE_CATEGORY},
+    [89] = {"py", SOURCE_CATEGORY},
+    [90] = {"deb", PACKAGE_CATEGORY},
+    [95] = {"tar.lz", ARCHIVE_CATEGORY},
+    [97] = {"s", SOURCE_CATEGORY},
+    [99] = {"ppm", IMAGE_CATEGORY},
+    [109] = {"tiff", IMAGE_CATEGORY},
+    [113] = {"js", SOURCE_CATEGORY},
+    [114] = {"cpio", ARCHIVE_CATEGORY},
+    [120] = {"arj", ARCHIVE_CATEGORY},
+    [121] = {"h", SOURCE_CATEGORY},
+    [123] = {"pbm", IMAGE_CATEGORY},
+    [125] = {"sh", SOURCE_CATEGORY},
+    [127] = {"tzst", ARCHIVE_CATEGORY},
+    [128] = {"7z", ARCHIVE_CATEGORY},
+    [135] = {"hxx", SOURCE_CATEGORY},
+    [139] = {"asm", SOURCE_CATEGORY},
+    [144] = {"tar.bz2", ARCHIVE_CATEGORY},
+    [150] = {"go", SOURCE_CATEGORY},
+    [153] = {"pcx", IMAGE_CATEGORY},
+    [158] = {"tar.zst", ARCHIVE_CATEGORY},
+    [159] = {"webp", IMAGE_CATEGORY},
+    [164] = {"tar", ARCHIVE_CATEGORY},
+    [165] = {"lua", SOURCE_CATEGORY},
+    [171] = {"java", SOURCE_CATEGORY},
+    [176] = {"gif", IMAGE_CATEGORY},
+    [177] = {"jpg", IMAGE_CATEGORY},
+    [181] = {"apk", PACKAGE_CATEGORY},
+    [186] = {"xpm", IMAGE_CATEGORY},
+    [190] = {"jar", ARCHIVE_CATEGORY},
+    [195] = {"pl", SOURCE_CATEGORY},
+    [199] = {"pkg.tar.gz", PACKAGE_CATEGORY},
+    [200] = {"taz", ARCHIVE_CATEGORY},
+    [202] = {"tbz2", ARCHIVE_CATEGORY},
+    [204] = {"bmp", IMAGE_CATEGORY},
+    [205] = {"rar", ARCHIVE_CATEGORY},
+    [208] = {"php", SOURCE_CATEGORY},
+    [212] = {"cpp", SOURCE_CATEGORY},
+    [214] = {"war", ARCHIVE_CATEGORY},
+    [215] = {"rs", SOURCE_CATEGORY},
+    [216] = {"bz2", COMPRESSED_CATEGORY},
+    [217] = {"lzh", ARCHIVE_CATEGORY},
+    [227] = {"rb", SOURCE_CATEGORY},
+    [228] = {"cab", ARCHIVE_CATEGORY},
+    [233] = {"lz", COMPRESSED_CATEGORY},
+    [243] = {"tgz", ARCHIVE_CATEGORY},
+    [245] = {"pkg.tar.zst", PACKAGE_CATEGORY},
+    [251] = {"ar", ARCHIVE_CATEGORY},
+};
+
+static const char *ls_keys[NUM_LS_KEYS] = {"di", "ln", "ex", "fi", "pi", "so", "bd", "cd", "su", "sg", "tw", "ow", "st"};
+static attr_t ls_type[NUM_LS_KEYS];
+static int ls_set;
+static struct ls_ext ls_exts[LS_TABLE_SIZE];
+static int num_ls_exts;
+static short ls_pairs[2][256];
+static int num_ls_pairs;
+
+/*
+ * Returns category of name, from its extension(s): longest known one wins,
+ * so that "a.pkg.tar.xz" is a package, "a.tar.xz" an archive and "a.xz" compressed.
+ * Only name's last path component is looked at, case is ignored.
+ */
+int file_category(const char *name) {
+    int cat = NO_CATEGORY;
+    
+    lookup_exts(name, category_lookup, &cat);
+    return cat;
+}
+
+/*
+ * Sets up default color pairs for file categories,
+ * then parses LS_COLORS (if set) allocating a color pair for each new
+ * foreground/background couple. Needs colors to be already started.
+ */
+void init_file_colors(void) {
+    const char *str = getenv("LS_COLORS");
+    
+    init_pair(IMAGE_COL, COLOR_MAGENTA, -1);
+    if (str) {
+        parse_ls_colors(str);
+    }
+}
+
+/*
+ * Returns attributes to print a file with, following ls:
+ * file type (and special permissions) first, then LS_COLORS extensions,
+ * then file category. It only uses given (cached) mode, no syscall is needed.
+ */
+attr_t file_color(const char *name, mode_t mode) {
+    int key = -1;
+    attr_t attr;
+    
+    if (S_ISDIR(mode)) {
+        if ((mode & S_ISVTX) && (mode & S_IWOTH) && (ls_set & (1 << LS_TW))) {
+            key = LS_TW;
+        } else if ((mode & S_IWOTH) && (ls_set & (1 << LS_OW))) {
+            key = LS_OW;
+        } else if ((mode & S_ISVTX) && (ls_set & (1 << LS_ST))) {
+            key = LS_ST;
+        } else {
+            key = LS_DI;
+        }
+    } else if (S_ISLNK(mode)) {
+        key = LS_LN;
+    } else if (S_ISFIFO(mode)) {
+        key = LS_PI;
+    } else if (S_ISSOCK(mode)) {
+        key = LS_SO;
+    } else if (S_ISBLK(mode)) {
+        key = LS_BD;
+    } else if (S_ISCHR(mode)) {
+        key = LS_CD;
+    } else if ((mode & S_ISUID) && (ls_set & (1 << LS_SU))) {
+        key = LS_SU;
+    } else if ((mode & S_ISGID) && (ls_set & (1 << LS_SG))) {
+        key = LS_SG;
+    } else if (mode & S_IXUSR) {
+        key = LS_EX;
+    }
+    if (key != -1 && (ls_set & (1 << key))) {
+        return ls_type[key];
+    }
+    switch (key) {
+    case LS_DI:
+        return COLOR_PAIR(1);
+    case LS_LN:
+        return COLOR_PAIR(2);
+    case LS_EX:
+        return COLOR_PAIR(3);
+    case -1:
+        break;
+    default:
+        return 0;
+    }
+    if (num_ls_exts && lookup_exts(name, ls_lookup, &attr)) {
+        return attr;
+    }
+    switch (file_category(name)) {
+    case ARCHIVE_CATEGORY:
+    case PACKAGE_CATEGORY:
+    case COMPRESSED_CATEGORY:
+        return COLOR_PAIR(5);
+    case IMAGE_CATEGORY:
+        return COLOR_PAIR(IMAGE_COL);
+    default:
+        return (ls_set & (1 << LS_FI)) ? ls_type[LS_FI] : 0;
+    }
+}
+
+/*
+ * FNV-1a of folded ext.
+ */
+static uint32_t ext_hash(const char *ext, size_t len) {
+    uint32_t h = 2166136261u;
+    
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)tolower((unsigned char)ext[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Calls lookup on name's extensions, from the longest one
+ * (starting after its MAX_EXT_DOTS-th last dot) to the shortest one,
+ * until one of them is found. A leading dot (hidden files) does not start an extension.
+ */
+static int lookup_exts(const char *name, int (*lookup)(const char *ext, size_t len, void *res), void *res) {
+    const char *base = strrchr(name, '/'), *end, *dots[MAX_EXT_DOTS];
+    int n = 0;
+    
+    base = base ? base + 1 : name;
+    end = base + strlen(base);
+    for (const char *p = end - 1; p > base && n < MAX_EXT_DOTS && end - p <= MAX_EXT_LEN + 1; p--) {
+        if (*p == '.') {
+            dots[n++] = p;
+        }
+    }
+    while (n--) {
+        if (lookup(dots[n] + 1, end - dots[n] - 1, res)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int category_lookup(const char *ext, size_t len, void *res) {
+    const struct ext_category *e = &ext_table[(ext_hash(ext, len) * EXT_HASH_SEED) >> 24];
+    
+    if (e->ext && strlen(e->ext) == len && !strncasecmp(e->ext, ext, len)) {
+        *(int *)res = e->category;
+        return 1;
+    }
+    return 0;
+}
+
+static int ls_lookup(const char *ext, size_t len, void *res) {
+    for (uint32_t i = ext_hash(ext, len) & (LS_TABLE_SIZE - 1); ls_exts[i].ext[0]; i = (i + 1) & (LS_TABLE_SIZE - 1)) {
+        if (strlen(ls_exts[i].ext) == len && !strncasecmp(ls_exts[i].ext, ext, len)) {
+            *(attr_t *)res = ls_exts[i].attr;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * LS_COLORS is a ':' separated list of "key=sgr" entries;
+ * keys are either file types (see ls_keys) or "*.ext" patterns.
+ * Other "*" patterns (not an extension) and unknown keys are ignored.
+ */
+static void parse_ls_colors(const char *str) {
+    char *colors = strdup(str), *saveptr = NULL;
+    
+    if (!colors) {
+        return;
+    }
+    for (char *tok = strtok_r(colors, ":", &saveptr); tok; tok = strtok_r(NULL, ":", &saveptr)) {
+        char *sgr = strchr(tok, '=');
+        
+        if (!sgr) {
+            continue;
+        }
+        *sgr++ = '\0';
+        if (!strncmp(tok, "*.", 2)) {
+            add_ls_ext(tok + 2, strlen(tok + 2), sgr_to_attr(sgr));
+            continue;
+        }
+        for (int i = 0; i < NUM_LS_KEYS; i++) {
+            if (!strcmp(tok, ls_keys[i])) {
+                ls_type[i] = sgr_to_attr(sgr);
+                ls_set |= 1 << i;
+                break;
+            }
+        }
+    }
+    free(colors);
+}
+
+static void add_ls_ext(const char *ext, size_t len, attr_t attr) {
+    uint32_t i;
+    
+    if (!len || len > MAX_EXT_LEN || strchr(ext, '*') || num_ls_exts >= LS_TABLE_SIZE / 2) {
+        return;
+    }
+    for (i = ext_hash(ext, len) & (LS_TABLE_SIZE - 1); ls_exts[i].ext[0]; i = (i + 1) & (LS_TABLE_SIZE - 1)) {
+        if (!strcasecmp(ls_exts[i].ext, ext)) {
+            // later entries override earlier ones, as in ls
+            ls_exts[i].attr = attr;
+            return;
+        }
+    }
+    strcpy(ls_exts[i].ext, ext);
+    ls_exts[i].attr = attr;
+    num_ls_exts++;
+}
+
+/*
+ * Converts a ';' separated list of SGR codes to curses attributes:
+ * bold, underline, blink, reverse, plus foreground and background colors
+ * (8 basic ones, bright ones and 256 colors ones, if terminal supports them).
+ */
+static attr_t sgr_to_attr(const char *sgr) {
+    attr_t attr = 0;
+    short fg = -1, bg = -1;
+    
+    while (*sgr) {
+        char *end;
+        long code = strtol(sgr, &end, 10);
+        
+        if (end == sgr) {
+            break;
+        }
+        sgr = *end == ';' ? end + 1 : end;
+        if (code == 0) {
+            attr = 0;
+            fg = bg = -1;
+        } else if (code == 1) {
+            attr |= A_BOLD;
+        } else if (code == 4) {
+            attr |= A_UNDERLINE;
+        } else if (code == 5) {
+            attr |= A_BLINK;
+        } else if (code == 7) {
+            attr |= A_REVERSE;
+        } else if (code >= 30 && code <= 37) {
+            fg = code - 30;
+        } else if (code >= 40 && code <= 47) {
+            bg = code - 40;
+        } else if (code >= 90 && code <= 97) {
+            fg = COLORS >= 16 ? code - 90 + 8 : code - 90;
+        } else if (code >= 100 && code <= 107) {
+            bg = COLORS >= 16 ? code - 100 + 8 : code - 100;
+        } else if ((code == 38 || code == 48) && !strncmp(sgr, "5;", 2)) {
+            long c = strtol(sgr + 2, &end, 10);
+            
+            sgr = *end == ';' ? end + 1 : end;
+            if (c >= 0 && c < COLORS) {
+                *(code == 38 ? &fg : &bg) = c;
+            }
+        }
+    }
+    return attr | COLOR_PAIR(color_pair(fg, bg));
+}
+
+/*
+ * Returns a color pair for fg/bg, allocating it if it is new
+ * (0, default colors, if no more pairs are available).
+ */
+static short color_pair(short fg, short bg) {
+    if (fg == -1 && bg == -1) {
+        return 0;
+    }
+    for (int i = 0; i < num_ls_pairs; i++) {
+        if (ls_pairs[0][i] == fg && ls_pairs[1][i] == bg) {
+            return FIRST_LS_COL + i;
+        }
+    }
+    if (num_ls_pairs == 256 - FIRST_LS_COL || FIRST_LS_COL + num_ls_pairs >= COLOR_PAIRS) {
+        return 0;
+    }
+    if (init_pair(FIRST_LS_COL + num_ls_pairs, fg, bg) == ERR) {
+        return 0;
+    }
+    ls_pairs[0][num_ls_pairs] = fg;
+    ls_pairs[1][num_ls_pairs] = bg;
+    return FIRST_LS_COL + num_ls_pairs++;
+}
@@ -0,0 +1,326 @@
+#include "../inc/filter.h"
+
+/*
+ * Plain patterns are looked for inside names,
+ * "~" ones match if their chars appear in order,
+ * patterns with any of "*?[" chars are globs.
+ */
+enum filter_kind {SUBSTR_FILTER, FUZZY_FILTER, GLOB_FILTER};
+
+/*
+ * ASCII case folding, and SWAR helpers:
+ * HAS_ZERO(v) is non zero if any byte of the 8 bytes word v is zero.
+ */
+#define FOLD(c) ((c) >= 'A' && (c) <= 'Z' ? (c) | 0x20 : (c))
+#define ONES 0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+#define HAS_ZERO(v) (((v) - ONES) & ~(v) & HIGHS)
+
+/*
+ * Shared by filter threads: each one matches next FILTER_CHUNK entries
+ * until the list is over, writing its own bytes of match[].
+ */
+struct filter_job {
+    const struct file_list *l;
+    const char *pattern;
+    size_t len;
+    int kind;
+    unsigned char *match;
+    int next;
+};
+
+static int pattern_kind(const char *pattern);
+static int filter_entries(int win, const struct file_list *src, const char *pattern);
+static void *filter_thread(void *x);
+static void filter_parallel(struct filter_job *job);
+static void match_range(struct filter_job *job, int start, int end);
+static int find_folded(const char *name, size_t len, const char *pattern, size_t plen);
+static int match_at(const unsigned char *s, const char *pattern, size_t plen);
+static int fuzzy_match(const char *name, const char *pattern);
+static void show_filtered(int win);
+
+static int mismatch;
+
+/*
+ * Enters filter mode in active tab: every listed file is shown,
+ * until something is typed.
+ */
+void show_filter(void) {
+    char title[PATH_MAX + 1] = {0};
+
+    memset(ps[active].filter_str, 0, sizeof(ps[active].filter_str));
+    if (filter_entries(active, &ps[active].nl, "") <= 0) {
+        return;
+    }
+    snprintf(title, PATH_MAX, _(filter_mode_str), "");
+    show_special_tab(ps[active].filtered.num, &ps[active].filtered, title, filter_);
+}
+
+/*
+ * Appends c to active tab's filter (or removes its last char, for backspace),
+ * then filters its list again.
+ * Appending a char can only drop files, so shown ones are filtered,
+ * unless it turned the filter into a glob.
+ * If nothing matches, previous matches are kept on screen.
+ */
+void filter_key(wint_t c) {
+    char pattern[NAME_MAX + 1], mbchar[MB_LEN_MAX], str[NAME_MAX + 100];
+    const struct file_list *src = &ps[active].nl;
+    size_t len;
+    int n;
+
+    strcpy(pattern, ps[active].filter_str);
+    len = strlen(pattern);
+    if (c == 127 || c == KEY_BACKSPACE) {
+        if (!len) {
+            return;
+        }
+        // remove utf8 continuation bytes too
+        while (len > 0 && (pattern[--len] & 0xC0) == 0x80);
+        pattern[len] = '\0';
+    } else {
+        n = wctomb(mbchar, c);
+        if (n <= 0 || len + n > NAME_MAX) {
+            return;
+        }
+        memcpy(pattern + len, mbchar, n);
+        pattern[len + n] = '\0';
+        if (pattern_kind(pattern) != GLOB_FILTER && pattern_kind(pattern) == pattern_kind(ps[active].filter_str)) {
+            src = &ps[active].filtered;
+        }
+    }
+    strcpy(ps[active].filter_str, pattern);
+    n = filter_entries(active, src, pattern);
+    if (n == 0) {
+        snprintf(str, sizeof(str), _(no_match), pattern);
+        print_info(str, INFO_LINE);
+        mismatch = 1;
+    } else if (n > 0) {
+        if (mismatch) {
+            print_info("", INFO_LINE);
+            mismatch = 0;
+        }
+        show_filtered(active);
+    }
+}
+
+/*
+ * Filters win's list again, after it changed while in filter mode,
+ * keeping cursor at the same index.
+ * If nothing matches anymore, filter mode is left.
+ */
+void update_filter(int win) {
+    int pos = ps[win].curr_pos;
+    int n = filter_entries(win, &ps[win].nl, ps[win].filter_str);
+
+    if (n == 0) {
+        leave_special_mode(NULL, win);
+    } else if (n > 0) {
+        show_filtered(win);
+        move_cursor(win, pos < n ? pos : n - 1);
+    }
+}
+
+static int pattern_kind(const char *pattern) {
+    if (pattern[0] == '~') {
+        return FUZZY_FILTER;
+    }
+    if (strpbrk(pattern, "*?[")) {
+        return GLOB_FILTER;
+    }
+    return SUBSTR_FILTER;
+}
+
+/*
+ * Matches listed entries of src against pattern, then copies matching ones
+ * (and src's arena, as their names are stored there) to win's filtered list.
+ * src may be the filtered list itself: it is then compacted in place.
+ * Returns number of matches (if none, filtered list is left untouched), or -1.
+ */
+static int filter_entries(int win, const struct file_list *src, const char *pattern) {
+    struct file_list *dst = &ps[win].filtered;
+    struct filter_job job = { .l = src, .kind = pattern_kind(pattern), .next = 0 };
+    char folded[NAME_MAX + 1] = {0};
+    int count = 0;
+
+    // globs are matched as they are, the others are folded once here
+    job.pattern = pattern;
+    if (job.kind != GLOB_FILTER) {
+        if (job.kind == FUZZY_FILTER) {
+            pattern++;
+        }
+        for (int i = 0; pattern[i]; i++) {
+            folded[i] = FOLD(pattern[i]);
+        }
+        job.pattern = folded;
+    }
+    job.len = strlen(job.pattern);
+    if (!src->num) {
+        return 0;
+    }
+    if (!(job.match = calloc(src->num, sizeof(unsigned char)))) {
+        goto error;
+    }
+    filter_parallel(&job);
+    for (int i = 0; i < src->num; i++) {
+        count += job.match[i];
+    }
+    if (count && dst != src) {
+        struct file_entry *entries;
+        char *arena;
+
+        if (!(entries = realloc(dst->entries, count * sizeof(struct file_entry)))) {
+            goto error;
+        }
+        dst->entries = entries;
+        dst->size = count;
+        if (!(arena = realloc(dst->arena, src->arena_len))) {
+            goto error;
+        }
+        memcpy(arena, src->arena, src->arena_len);
+        dst->arena = arena;
+        dst->arena_len = dst->arena_size = src->arena_len;
+        dst->holes = src->holes;
+        memcpy(dst->prefix, src->prefix, sizeof(dst->prefix));
+        dst->prefix_len = src->prefix_len;
+    }
+    if (count) {
+        for (int i = 0, j = 0; i < src->num; i++) {
+            if (job.match[i]) {
+                dst->entries[j++] = src->entries[i];
+            }
+        }
+        dst->num = count;
+        dst->num_hidden = 0;
+        drop_name_index(dst);
+    }
+    free(job.match);
+    return count;
+
+error:
+    free(job.match);
+    quit = MEM_ERR_QUIT;
+    ERROR("could not malloc.");
+    return -1;
+}
+
+static void *filter_thread(void *x) {
+    struct filter_job *job = (struct filter_job *)x;
+    int i;
+
+    while (!quit && (i = __sync_fetch_and_add(&job->next, FILTER_CHUNK)) < job->l->num) {
+        match_range(job, i, i + FILTER_CHUNK < job->l->num ? i + FILTER_CHUNK : job->l->num);
+    }
+    return NULL;
+}
+
+/*
+ * Lists with at least FILTER_PARALLEL_MIN entries are split between
+ * up to MAX_FILTER_THREADS threads (current one included), one for each online cpu.
+ */
+static void filter_parallel(struct filter_job *job) {
+    pthread_t th[MAX_FILTER_THREADS];
+    long num_th = job->l->num < FILTER_PARALLEL_MIN ? 1 : sysconf(_SC_NPROCESSORS_ONLN);
+    int started = 0;
+
+    if (num_th > MAX_FILTER_THREADS) {
+        num_th = MAX_FILTER_THREADS;
+    }
+    for (int i = 0; i < num_th - 1; i++) {
+        if (pthread_create(&th[started], NULL, filter_thread, job) == 0) {
+            started++;
+        }
+    }
+    filter_thread(job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(th[i], NULL);
+    }
+}
+
+static void match_range(struct filter_job *job, int start, int end) {
+    for (int i = start; i < end; i++) {
+        const char *name = list_name(job->l, i);
+
+        switch (job->kind) {
+        case GLOB_FILTER:
+            job->match[i] = !fnmatch(job->pattern, name, FNM_CASEFOLD);
+            break;
+        case FUZZY_FILTER:
+            job->match[i] = fuzzy_match(name, job->pattern);
+            break;
+        default:
+            job->match[i] = find_folded(name, job->l->entries[i].name_len, job->pattern, job->len);
+            break;
+        }
+    }
+}
+
+/*
+ * Looks for folded pattern inside name (ignoring ASCII case).
+ * Positions where its first char appears are found 8 bytes at a time:
+ * word is XOR-ed with that char repeated in each byte, so matching bytes become zero
+ * (for letters, OR-ing 0x20 first folds upper case bytes to lower case).
+ * HAS_ZERO may flag bytes above a real zero too: every byte of a flagged word is checked.
+ */
+static int find_folded(const char *name, size_t len, const char *pattern, size_t plen) {
+    const unsigned char *s = (const unsigned char *)name;
+    const unsigned char first = pattern[0];
+    const uint64_t fold = (first >= 'a' && first <= 'z') ? ONES * 0x20 : 0;
+    const uint64_t rep = ONES * first;
+    size_t i = 0, last;
+
+    if (!plen) {
+        return 1;
+    }
+    if (plen > len) {
+        return 0;
+    }
+    // last position where pattern may start
+    last = len - plen;
+    for (; i + 8 <= last + 1; i += 8) {
+        uint64_t w;
+
+        memcpy(&w, s + i, sizeof(w));
+        w = (w | fold) ^ rep;
+        if (HAS_ZERO(w)) {
+            for (size_t j = i; j < i + 8; j++) {
+                if (match_at(s + j, pattern, plen)) {
+                    return 1;
+                }
+            }
+        }
+    }
+    for (; i <= last; i++) {
+        if (match_at(s + i, pattern, plen)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int match_at(const unsigned char *s, const char *pattern, size_t plen) {
+    for (size_t k = 0; k < plen; k++) {
+        if (FOLD(s[k]) != (unsigned char)pattern[k]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int fuzzy_match(const char *name, const char *pattern) {
+    for (; *pattern && *name; name++) {
+        if (FOLD((unsigned char)*name) == (unsigned char)*pattern) {
+            pattern++;
+        }
+    }
+    return !*pattern;
+}
+
+/*
+ * Prints win's filtered list, with its filter as title.
+ */
+static void show_filtered(int win) {
+    snprintf(ps[win].title, PATH_MAX, _(filter_mode_str), ps[win].filter_str);
+    ps[win].number_of_files = ps[win].filtered.num;
+    reset_win(win);
+}
@@ -5,11 +5,13 @@ static void open_file(const char *str);
 static int new_file(const char *name);
 static int new_dir(const char *name);
 static int rename_file_folders(const char *name);
-static void select_file(const char *str);
+static void mark_selected(const char *str, int value);
 static void select_all(void);
 static void deselect_all(void);
 static void cpr(const char *tmp);
 static int recursive_copy(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf);
+static int copy_file(int fd_from, int fd_to, const struct stat *sb);
+static int copy_data(int fd_from, int fd_to, off_t len);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,5,0)
 static loff_t copy_file_range(int fd_in, loff_t *off_in, int fd_out,
                               loff_t *off_out, size_t len, unsigned int flags);
@@ -17,48 +19,56 @@ static loff_t copy_file_range(int fd_in, loff_t *off_in, int fd_out,
 static int recursive_remove(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf);
 static void rmrf(const char *path);
 
-#ifdef SYSTEMD_PRESENT
-static const char *pkg_ext[] = {".pkg.tar.xz", ".deb", ".rpm"};
-#endif
-static int distance_from_root, is_selecting;
+static int is_selecting;
+// nftw callbacks run by worker threads need their own root distance
+static __thread int distance_from_root;
 static int (*const short_func[SHORT_FILE_OPERATIONS])(const char *) = {
     new_file, new_dir, rename_file_folders
 };
 
+/*
+ * Moves win to str (relative to win's cwd if not absolute).
+ * No syscall is made here, as it could block UI (eg: on a hung mount):
+ * new cwd is computed lexically, then win's dir_job opens it and sets up its inotify watch.
+ * If it turns out dir cannot be opened, win goes back to its old cwd.
+ * Process cwd is never changed: every path used is absolute.
+ */
 int change_dir(const char *str, int win) {
-    int ret = 0;
-    const int event_mask = IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVE;
+    char old_cwd[PATH_MAX + 1], old_file[NAME_MAX + 1] = {0};
     
-    if (chdir(str) != -1) {
-        getcwd(ps[win].my_cwd, PATH_MAX);
-        strncpy(ps[win].title, ps[win].my_cwd, PATH_MAX);
-        tab_refresh(win);
-        inotify_rm_watch(ps[win].inot.fd, ps[win].inot.wd);
-        ps[win].inot.wd = inotify_add_watch(ps[win].inot.fd, ps[win].my_cwd, event_mask);
-        // reset selecting status (double space to select all)
-        // when changing dir
-        is_selecting = 0;
-    } else {
-        print_info(strerror(errno), ERR_LINE);
-        ret = -1;
+    strcpy(old_cwd, ps[win].my_cwd);
+    if (str_ptr[win] == &ps[win].nl && ps[win].curr_pos < ps[win].nl.num) {
+        strncpy(old_file, list_name(&ps[win].nl, ps[win].curr_pos), NAME_MAX);
+    }
+    if (make_path(old_cwd, str, ps[win].my_cwd) == -1) {
+        print_info(strerror(ENAMETOOLONG), ERR_LINE);
+        return -1;
     }
-    // force process dir to be active tab's one
-    if (win != active) {
-        chdir(ps[active].my_cwd);
+    strncpy(ps[win].title, ps[win].my_cwd, PATH_MAX);
+    // reset selecting status (double space to select all)
+    // when changing dir
+    is_selecting = 0;
+    if (tab_refresh(win) == -1) {
+        if (strlen(old_cwd) && strcmp(old_cwd, ps[win].my_cwd)) {
+            strcpy(ps[win].my_cwd, old_cwd);
+            strncpy(ps[win].title, ps[win].my_cwd, PATH_MAX);
+            strcpy(ps[win].old_file, old_file);
+            tab_refresh(win);
+        }
+        return -1;
     }
-    return ret;
+    return 0;
 }
 
 void change_tab(void) {
     active = !active;
-    chdir(ps[active].my_cwd);
     update_colors();
 }
 
 void switch_hidden(void) {
     ps[active].show_hidden = !ps[active].show_hidden;
     save_old_pos(active);
-    tab_refresh(active);
+    tab_resort(active);
 }
 
 /*
@@ -74,7 +84,7 @@ void manage_file(const char *str) {
         isomount(str);
         return;
     }
-    if (is_ext(str, pkg_ext, NUM(pkg_ext))) {
+    if (file_category(str) == PACKAGE_CATEGORY) {
         char c;
         if (config.safe != UNSAFE) {
             print_info(_(package_warn), INFO_LINE);
@@ -114,7 +124,9 @@ static void xdg_open(const char *str) {
  * if config.editor is set opens the file with it.
  */
 static void open_file(const char *str) {
-    if ((!get_mimetype(str, "text/")) && (!get_mimetype(str, "x-empty"))) {
+    char type[MIMETYPE_LEN];
+    
+    if (read_mimetype(str, type) == -1 || (!strstr(type, "text/") && !strstr(type, "x-empty"))) {
         return;
     }
     if (strlen(config.editor)) {
@@ -157,20 +169,35 @@ void fast_file_operations(const int index) {
 }
 
 int new_file(const char *name) {
-    int fd = open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
-    if (fd != -1) {
+    char path[PATH_MAX + 1];
+    int fd;
+    
+    if (make_path(ps[active].my_cwd, name, path) == -1) {
+        return -ENAMETOOLONG;
+    }
+    if ((fd = open(path, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) != -1) {
         close(fd);
         return 0;
     }
-    return fd;
+    return -errno;
 }
 
 static int new_dir(const char *name) {
-    return mkdir(name, 0700);
+    char path[PATH_MAX + 1];
+    
+    if (make_path(ps[active].my_cwd, name, path) == -1) {
+        return -ENAMETOOLONG;
+    }
+    return mkdir(path, 0700) == -1 ? -errno : 0;
 }
 
 static int rename_file_folders(const char *name) {
-    return rename(ps[active].nl[ps[active].curr_pos], name);
+    char path[PATH_MAX + 1], new_path[PATH_MAX + 1];
+    
+    if (make_path(ps[active].my_cwd, name, new_path) == -1) {
+        return -ENAMETOOLONG;
+    }
+    return rename(list_fullpath(&ps[active].nl, ps[active].curr_pos, path), new_path) == -1 ? -errno : 0;
 }
 
 /*
@@ -181,48 +208,51 @@ static int rename_file_folders(const char *name) {
 int remove_file(void) {
     int ok = 0;
 
-    for (int i = 0; i < thread_h->num_selected; i++) {
-        if (access(thread_h->selected_files[i], W_OK) == 0) {
+    for (int i = 0; i < current_job->selected_files.num && !job_cancelled(); i++) {
+        const char *str = list_name(&current_job->selected_files, i);
+        
+        if (access(str, W_OK) == 0) {
             ok++;
-            rmrf(thread_h->selected_files[i]);
+            rmrf(str);
         }
     }
     return (ok ? 0 : -1);
 }
 
 /*
- * If there are no selected files, or the file user selected wasn't already selected (remove_from_list() returns 0),
- * add this file to select list.
+ * If str was not selected, it is added to selected files; otherwise it is removed.
  */
 void manage_space_press(const char *str) {
     int idx;
-    char c;
-    int i = is_present(str, selected, num_selected, -1, 0);
-
-    if (i == -1) {
-        select_file(str);
+    
+    if (select_path(str) == 0) {
         idx = 0;
-        c = '*';
+        mark_selected(str, 1);
     } else {
-        selected = remove_from_list(&num_selected, selected, i);
-        c = ' ';
-        num_selected ? (idx = 1) : (idx = 2);
+        unselect_path(str);
+        mark_selected(str, 0);
+        selected.num ? (idx = 1) : (idx = 2);
     }
     print_info(_(file_sel[idx]), INFO_LINE);
-    highlight_selected(str, c, active);
-    if (!strcmp(ps[active].my_cwd, ps[!active].my_cwd)) {
-        highlight_selected(str, c, !active);
-    }
-    update_special_mode(num_selected, selected, selected_);
+    update_special_mode(selected.num, &selected, selected_);
 }
 
-static void select_file(const char *str) {
-    selected = safe_realloc(++num_selected, selected);
-    if (quit) {
-        return;
+/*
+ * Updates selected flag of str's entry in each tab listing its dir,
+ * and redraws its selection mark.
+ */
+static void mark_selected(const char *str, int value) {
+    const char *name = strrchr(str, '/') + 1;
+    
+    for (int win = 0; win < cont; win++) {
+        if (ps[win].nl.prefix_len == (size_t)(name - str) && !strncmp(ps[win].nl.prefix, str, name - str)) {
+            int i = find_in_list(&ps[win].nl, name);
+            if (i != -1) {
+                ps[win].nl.entries[i].selected = value;
+                highlight_selected(win, i);
+            }
+        }
     }
-    memset(selected[num_selected - 1], 0, PATH_MAX + 1);
-    strncpy(selected[num_selected - 1], str, PATH_MAX);
 }
 
 void manage_all_space_press(void) {
@@ -234,83 +264,72 @@ void manage_all_space_press(void) {
         idx = 3;
     } else {
         deselect_all();
-        selected ? (idx = 4) : (idx = 5);
+        selected.num ? (idx = 4) : (idx = 5);
     }
     print_info(_(file_sel[idx]), INFO_LINE);
-    update_special_mode(num_selected, selected, selected_);
+    update_special_mode(selected.num, &selected, selected_);
 }
 
 static void select_all(void) {
+    char path[PATH_MAX + 1];
+    struct file_list *l = &ps[active].nl;
+    
     for (int i = 0; i < ps[active].number_of_files; i++) {
-        if (strcmp(strrchr(ps[active].nl[i], '/') + 1, "..")) {
-            if (is_present(ps[active].nl[i], selected, num_selected, -1, 0) != -1) {
-                continue;
-            }
-            select_file(ps[active].nl[i]);
-            highlight_selected(ps[active].nl[i], '*', active);
-            if (!strcmp(ps[active].my_cwd, ps[!active].my_cwd)) {
-                highlight_selected(ps[active].nl[i], '*', !active);
-            }
+        if (!l->entries[i].selected && strcmp(list_name(l, i), "..")) {
+            select_path(list_fullpath(l, i, path));
+            l->entries[i].selected = 1;
         }
     }
+    highlight_selected(active, -1);
+    if (!strcmp(ps[active].my_cwd, ps[!active].my_cwd)) {
+        sync_selection(&ps[!active].nl);
+        highlight_selected(!active, -1);
+    }
 }
 
 static void deselect_all(void) {
-    for (int i = 0; i < ps[active].number_of_files; i++) {
-        int j = is_present(ps[active].nl[i], selected, num_selected, -1, 0);
-        if (j != -1) {
-            selected = remove_from_list(&num_selected, selected, j);
-            highlight_selected(ps[active].nl[i], ' ', active);
-            if (!strcmp(ps[active].my_cwd, ps[!active].my_cwd)) {
-                highlight_selected(ps[active].nl[i], ' ', !active);
-            }
-        }
+    unselect_listed(&ps[active].nl, ps[active].number_of_files);
+    highlight_selected(active, -1);
+    if (!strcmp(ps[active].my_cwd, ps[!active].my_cwd)) {
+        sync_selection(&ps[!active].nl);
+        highlight_selected(!active, -1);
     }
 }
 
 void remove_selected(void) {
+    char path[PATH_MAX + 1];
     int idx;
     
-    if (!strcmp(ps[active].my_cwd, ps[!active].my_cwd)) {
-        highlight_selected(selected[ps[active].curr_pos], ' ', !active);
-    }
-    selected = remove_from_list(&num_selected, selected, ps[active].curr_pos);
-    if (num_selected) {
+    strncpy(path, list_name(&selected, ps[active].curr_pos), PATH_MAX);
+    unselect_path(path);
+    mark_selected(path, 0);
+    if (selected.num) {
         idx = 1;
     } else {
         idx = 2;
     }
-    update_special_mode(num_selected, selected, selected_);
+    update_special_mode(selected.num, &selected, selected_);
     print_info(_(file_sel[idx]), INFO_LINE);
 }
 
 void remove_all_selected(void) {
-    for (int i = 0; i < num_selected; i++) {
-        if (cont == 2) {
-            highlight_selected(selected[i], ' ', !active);
-        }
+    free_list(&selected);
+    reset_selection();
+    for (int win = 0; win < cont; win++) {
+        highlight_selected(win, -1);
     }
-    free(selected);
-    selected = NULL;
-    num_selected = 0;
-    update_special_mode(num_selected, selected, selected_);
+    update_special_mode(selected.num, &selected, selected_);
     print_info(_(selected_cleared), INFO_LINE);
 }
 
 void show_selected(void) {
-    if (num_selected) {
-        show_special_tab(num_selected, selected, selected_mode_str, selected_);
+    if (selected.num) {
+        show_special_tab(selected.num, &selected, selected_mode_str, selected_);
     } else {
         print_info(_(no_selected_files), INFO_LINE);
     }
 }
 
-void free_selected(void) {
-    if (selected) {
-        free(selected);
-    }
-}
-
 /*
  * For each file being pasted, it performs a check: 
  * it checks if file is being pasted in the same dir
@@ -319,11 +338,11 @@ void free_selected(void) {
 int paste_file(void) {
     char path[PATH_MAX + 1] = {0};
 
-    for (int i = 0; i < thread_h->num_selected; i++) {
-        strncpy(path, thread_h->selected_files[i], PATH_MAX);
+    for (int i = 0; i < current_job->selected_files.num && !job_cancelled(); i++) {
+        strncpy(path, list_name(&current_job->selected_files, i), PATH_MAX);
         char *copied_file_dir = dirname(path);
-        if (strcmp(thread_h->full_path, copied_file_dir)) {
-            cpr(thread_h->selected_files[i]);
+        if (strcmp(current_job->full_path, copied_file_dir)) {
+            cpr(list_name(&current_job->selected_files, i));
         }
     }
     return 0;
@@ -339,22 +358,28 @@ int move_file(void) {
     char pasted_file[PATH_MAX + 1] = {0}, path[PATH_MAX + 1] = {0};
     struct stat file_stat_copied, file_stat_pasted;
 
-    lstat(thread_h->full_path, &file_stat_pasted);
-    for (int i = 0; i < thread_h->num_selected; i++) {
-        strncpy(path, thread_h->selected_files[i], PATH_MAX);
+    lstat(current_job->full_path, &file_stat_pasted);
+    for (int i = 0; i < current_job->selected_files.num && !job_cancelled(); i++) {
+        const char *str = list_name(&current_job->selected_files, i);
+        
+        strncpy(path, str, PATH_MAX);
         char *copied_file_dir = dirname(path);
-        if (strcmp(thread_h->full_path, copied_file_dir)) {
+        if (strcmp(current_job->full_path, copied_file_dir)) {
             lstat(copied_file_dir, &file_stat_copied);
             if (file_stat_copied.st_dev == file_stat_pasted.st_dev) { // if on the same fs, just rename the file
                 snprintf(pasted_file, PATH_MAX, "%s%s", 
-                         thread_h->full_path, 
-                         strrchr(thread_h->selected_files[i], '/'));
-                if (rename(thread_h->selected_files[i], pasted_file) == - 1) {
+                         current_job->full_path, 
+                         strrchr(str, '/'));
+                job_file(str);
+                if (rename(str, pasted_file) == - 1) {
                     print_info(strerror(errno), ERR_LINE);
                 }
-            } else { // copy file and remove original file
-                cpr(thread_h->selected_files[i]);
-                rmrf(thread_h->selected_files[i]);
+                job_progress(0, 1);
+            } else { // copy file and remove original file (unless copy was cancelled)
+                cpr(str);
+                if (!job_cancelled()) {
+                    rmrf(str);
+                }
             }
         }
     }
@@ -365,8 +390,8 @@ int move_file(void) {
  * It calculates the "distance_from_root" of the current file, where root is 
  * the directory from where it is being copied (eg: copying /home/me/Scripts/ -> root is /home/me/).
  * Then calls nftw with recursive_copy.
- * distance_from_root is needed to make pasted_file relative to thread_h->full_path (ie: the folder where we're pasting).
- * In fact pasted_file will be "thread_h->full_path/(path + distance_from_root)".
+ * distance_from_root is needed to make pasted_file relative to current_job->full_path (ie: the folder where we're pasting).
+ * In fact pasted_file will be "current_job->full_path/(path + distance_from_root)".
  * If path is /home/me/Scripts/foo, and root is the same as above (/home/me/), in the pasted folder we'll have:
  * 1) /path/to/pasted/folder/Scripts/,
  * 2) /path/to/pasted/folder/Scripts/me, that is exactly what we wanted.
@@ -379,49 +404,134 @@ static void cpr(const char *tmp) {
     nftw(tmp, recursive_copy, 64, FTW_MOUNT | FTW_PHYS);
 }
 
+/*
+ * Each file is a cancellation checkpoint: a file whose copy has been cancelled is removed.
+ * Job counts which of copy_methods copied each file.
+ */
 static int recursive_copy(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf) {
     int ret = 0;
     char pasted_file[PATH_MAX + 1] = {0};
 
-    snprintf(pasted_file, PATH_MAX, "%s%s", thread_h->full_path, path + distance_from_root);
+    if (job_cancelled()) {
+        return -1;
+    }
+    snprintf(pasted_file, PATH_MAX, "%s%s", current_job->full_path, path + distance_from_root);
+    job_file(path);
     if (typeflag == FTW_D) {
         mkdir(pasted_file, sb->st_mode);
     } else {
         int fd_to = open(pasted_file, O_WRONLY | O_CREAT | O_EXCL | O_TRUNC, sb->st_mode);
         int fd_from = open(path, O_RDONLY);
         if ((fd_to != -1) && (fd_from != -1)) {
-            int len;
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,5,0)  // if linux >= 4.5 let's use copy_file_range
             struct stat stat;
             
             fstat(fd_from, &stat);
-            len = stat.st_size;
-            do {
-                ret = copy_file_range(fd_from, NULL, fd_to, NULL, len, 0);
-                if (ret == -1) {
-                    ret = -1;
-                    break;
-                }
-                len -= ret;
-            } while (len > 0);
-#else
-            int buff[BUFF_SIZE];
-            len = read(fd_from, buff, sizeof(buff));
-            while (len > 0) {
-                if (write(fd_to, buff, len) != len) {
-                    ret = -1;
-                    break;
-                }
-                len = read(fd_from, buff, sizeof(buff));
+            ret = copy_file(fd_from, fd_to, &stat);
+            if (ret != -1) {
+                current_job->copied_by[ret]++;
             }
-#endif
+        }
+        if (fd_to != -1 && job_cancelled()) {
+            unlink(pasted_file);
         }
         close(fd_to);
         close(fd_from);
     }
+    job_progress(0, 1);
     return (ret == -1) ? ret : 0;
 }
 
+/*
+ * Clones fd_from into fd_to, when possible: a clone shares data extents (btrfs, XFS),
+ * so it takes no time nor space. Otherwise its data is copied.
+ * Sparse files (with less blocks than their size) only get their data extents copied:
+ * holes are left by seeking over them (fd_to is a new file), and ftruncate recreates trailing one.
+ * Returns one of copy_methods, or -1.
+ */
+static int copy_file(int fd_from, int fd_to, const struct stat *sb) {
+    off_t data, hole = 0;
+
+#ifdef FICLONE
+    if (ioctl(fd_to, FICLONE, fd_from) == 0) {
+        job_progress(sb->st_size, 0);
+        return COPY_CLONE;
+    }
+#endif
+    if ((off_t)sb->st_blocks * 512 >= sb->st_size) {
+        return copy_data(fd_from, fd_to, sb->st_size);
+    }
+    while ((data = lseek(fd_from, hole, SEEK_DATA)) != -1) {
+        job_progress(data - hole, 0);
+        hole = lseek(fd_from, data, SEEK_HOLE);
+        if (hole == -1 || lseek(fd_from, data, SEEK_SET) == -1 || lseek(fd_to, data, SEEK_SET) == -1
+            || copy_data(fd_from, fd_to, hole - data) == -1) {
+            return -1;
+        }
+    }
+    // ENXIO: there is no more data after hole
+    if (errno != ENXIO || ftruncate(fd_to, sb->st_size) == -1) {
+        return -1;
+    }
+    job_progress(sb->st_size - hole, 0);
+    return COPY_SPARSE;
+}
+
+/*
+ * Copies len bytes from fd_from to fd_to (from their current offsets), trying
+ * copy_methods from the fastest one: copy_file_range and sendfile copy data in kernel.
+ * When a method fails, next one goes on from where it stopped.
+ * Each chunk copied is a cancellation checkpoint, and updates job progress.
+ * Returns method that copied last chunk, or -1.
+ */
+static int copy_data(int fd_from, int fd_to, off_t len) {
+    char *buff = NULL;
+    ssize_t ret = 0;
+    int method = COPY_RANGE;
+
+    while (len > 0) {
+        size_t chunk = len < COPY_CHUNK ? len : COPY_CHUNK;
+        
+        if (job_cancelled()) {
+            ret = -1;
+            break;
+        }
+        switch (method) {
+        case COPY_RANGE:
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,5,0)  // if linux >= 4.5 let's use copy_file_range
+            ret = copy_file_range(fd_from, NULL, fd_to, NULL, chunk, 0);
+#else
+            ret = -1;
+#endif
+            break;
+        case COPY_SENDFILE:
+            ret = sendfile(fd_to, fd_from, NULL, chunk);
+            break;
+        default:
+            if (!buff && !(buff = malloc(COPY_BUFF_SIZE))) {
+                quit = MEM_ERR_QUIT;
+                ERROR("could not malloc.");
+                ret = -1;
+                break;
+            }
+            ret = read(fd_from, buff, chunk < COPY_BUFF_SIZE ? chunk : COPY_BUFF_SIZE);
+            if (ret > 0 && write(fd_to, buff, ret) != ret) {
+                ret = -1;
+            }
+            break;
+        }
+        if (ret > 0) {
+            job_progress(ret, 0);
+            len -= ret;
+        } else if (ret == 0 || method == COPY_RW || quit) { // file was truncated meanwhile, or no method left
+            break;
+        } else {
+            method++;
+        }
+    }
+    free(buff);
+    return (ret == -1) ? ret : method;
+}
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,5,0)
 static loff_t copy_file_range(int fd_in, loff_t *off_in, int fd_out,
                                           loff_t *off_out, size_t len, unsigned int flags)
@@ -431,7 +541,17 @@ static loff_t copy_file_range(int fd_in, loff_t *off_in, int fd_out,
 }
 #endif
 
+/*
+ * Files removed by a move job have already been counted as copied.
+ */
 static int recursive_remove(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf) {
+    if (job_cancelled()) {
+        return -1;
+    }
+    if (current_job->type == RM_TH) {
+        job_file(path);
+        job_progress(0, 1);
+    }
     return remove(path);
 }
 /*
@@ -32,9 +32,11 @@ static void check_desktop(void);
 static void helper_function(int argc, char * const argv[]);
 static void main_loop(void);
 static void add_new_tab(void);
+static void manage_navigation(wint_t c);
 #ifdef SYSTEMD_PRESENT
 static void check_device_mode(void);
 #endif
+static int cursor_stat(const char *path, struct stat *st);
 static void manage_enter(struct stat current_file_stat);
 static void manage_enter_search(struct stat current_file_stat);
 static void manage_space(const char *str);
@@ -102,9 +104,9 @@ static int set_signals(void) {
 
 static void set_pollfd(void) {
 #if ARCHIVE_VERSION_NUMBER >= 3002000
-    nfds = 7;
+    nfds = 11;
 #else
-    nfds = 6;
+    nfds = 10;
 #endif
 #ifdef SYSTEMD_PRESENT
     nfds++;
@@ -124,24 +126,24 @@ static void set_pollfd(void) {
         };
     }
     
-    // inotify watcher init for each tab
-    ps[0].inot.fd = inotify_init();
-    ps[1].inot.fd = inotify_init();
+    // each tab's inotify watcher is set up by the dir_job listing its cwd
+    ps[0].inot.fd = -1;
+    ps[1].inot.fd = -1;
     main_p[INOTIFY_IX1] = (struct pollfd) {
-        .fd = ps[0].inot.fd,
+        .fd = -1,
         .events = POLLIN,
     };
     main_p[INOTIFY_IX2] = (struct pollfd) {
-        .fd = ps[1].inot.fd,
+        .fd = -1,
         .events = POLLIN,
     };
     
     // info init. This is needed to let
     // multiple threads print an information string
     // without any issue.
-    pipe(info_fd);
+    info_fd = eventfd(0, EFD_NONBLOCK);
     main_p[INFO_IX] = (struct pollfd) {
-        .fd = info_fd[0],
+        .fd = info_fd,
         .events = POLLIN,
     };
     
@@ -151,6 +153,38 @@ static void set_pollfd(void) {
         .events = POLLIN,
     };
     
+    // eventfd written by dir jobs when a big dir
+    // has been completely listed.
+    loader_fd = eventfd(0, EFD_NONBLOCK);
+    main_p[LOADER_IX] = (struct pollfd) {
+        .fd = loader_fd,
+        .events = POLLIN,
+    };
+    
+    // timerfd armed when tabs or info lines need to be updated:
+    // every update received until it fires is drawn in a single pass.
+    refresh_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    main_p[REFRESH_IX] = (struct pollfd) {
+        .fd = refresh_fd,
+        .events = POLLIN,
+    };
+    
+    // timerfd armed when cursor moves on a dir,
+    // to prefetch it if cursor is still there when it fires.
+    prefetch_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    main_p[PREFETCH_IX] = (struct pollfd) {
+        .fd = prefetch_fd,
+        .events = POLLIN,
+    };
+    
+    // timerfd armed by worker threads when a job starts or ends,
+    // to update jobs mode tabs and jobs progress.
+    jobs_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    main_p[JOBS_IX] = (struct pollfd) {
+        .fd = jobs_fd,
+        .events = POLLIN,
+    };
+    
 #if ARCHIVE_VERSION_NUMBER >= 3002000
     // NONBLOCK needed for EXTRACTOR_TH workaround when blocked 
     // inside a eventf read -> archive_cb_fd[0] is fd read by main_poll
@@ -232,6 +266,10 @@ static void helper_function(int argc, char * const argv[]) {
     config.starting_helper = 1;
     config.bat_low_level = 15;
     config.safe = FULL_SAFE;
+    config.loading_timeout = 100;
+    config.refresh_delay = 50;
+    config.dir_cache_size = 64;
+    config.jobs_per_device = 1;
 #ifdef SYSTEMD_PRESENT
     device_init = DEVMON_STARTING;
 #endif
@@ -247,14 +285,14 @@ static void helper_function(int argc, char * const argv[]) {
 }
 
 /*
- * When in fast_browse_mode do not enter switch case;
+ * When in fast_browse_mode (or filter mode, for printable chars) do not enter switch case;
  * if device_mode or search_mode are active on current window,
  * only 'q', 'l', or 't' (and enter, that is not printable char) can be called.
  * else stat current file and enter switch case.
  */
 static void main_loop(void) {
     int index;
-    char *ptr;
+    char *ptr, path[PATH_MAX + 1];
     
     /*
      * x to move,
@@ -275,11 +313,13 @@ static void main_loop(void) {
      * l switch helper_win,
      * t new tab,
      * m only in device_mode to {un}mount device,
-     * r in bookmarks_mode/selected mode to remove file from bookmarks/selected.
+     * r in bookmarks_mode/selected mode to remove file from bookmarks/selected,
+     * in jobs mode to cancel a job.
      * s to show stat
      * i to trigger fullname win
+     * c, +, - in jobs mode to pause/resume a job, or move it up/down.
      */
-    const char special_mode_allowed_chars[] = "ltmrsi";
+    const char special_mode_allowed_chars[] = "ltmrsic+-";
     
     /*
      * Not graphical wchars:
@@ -309,18 +349,19 @@ static void main_loop(void) {
             fast_browse(c);
             continue;
         }
+        if ((ps[active].mode == filter_) && ((iswgraph(c) && !wcschr(not_graph_wchars, c)) || c == 32 || c == 127 || c == KEY_BACKSPACE)) {
+            filter_key(c);
+            continue;
+        }
         c = tolower(c);
         if (ps[active].mode > fast_browse_ && (isprint(c) && !strchr(special_mode_allowed_chars, c))) {
             continue;
         }
         struct stat current_file_stat = {0};
-        stat(str_ptr[active][ps[active].curr_pos], &current_file_stat);
+        list_fullpath(str_ptr[active], ps[active].curr_pos, path);
         switch (c) {
-        case KEY_UP:
-            scroll_up(active, 1);
-            break;
-        case KEY_DOWN:
-            scroll_down(active, 1);
+        case KEY_UP: case KEY_DOWN: case KEY_PPAGE: case KEY_NPAGE:
+            manage_navigation(c);
             break;
         case KEY_RIGHT:
         case KEY_LEFT:
@@ -328,12 +369,6 @@ static void main_loop(void) {
                 change_tab();
             }
             break;
-        case KEY_PPAGE:
-            scroll_up(active, ps[active].curr_pos);
-            break;
-        case KEY_NPAGE:
-            scroll_down(active, ps[active].number_of_files - ps[active].curr_pos);
-            break;
         case 127: case KEY_BACKSPACE: // backspace to go to root folder
             if (ps[active].mode <= fast_browse_) {
                 go_root_dir();
@@ -343,7 +378,9 @@ static void main_loop(void) {
             switch_hidden();
             break;
         case 10: // enter to change dir or open a file.
-            manage_enter(current_file_stat);
+            if (cursor_stat(path, &current_file_stat) == 0) {
+                manage_enter(current_file_stat);
+            }
             break;
         case 't': // t to open second tab
             if (cont < MAX_TABS) {
@@ -360,7 +397,7 @@ static void main_loop(void) {
             }
             break;
         case 32: // space to select files
-            manage_space(str_ptr[active][ps[active].curr_pos]);
+            manage_space(path);
             break;
         case 'l':  // show helper mess
             trigger_show_helper_message();
@@ -369,15 +406,16 @@ static void main_loop(void) {
             trigger_stats();
             break;
         case 'e': // add file to bookmarks
-            add_file_to_bookmarks(str_ptr[active][ps[active].curr_pos]);
+            add_file_to_bookmarks(path);
             break;
         case 'f': // f to search
             switch_search();
             break;
 #ifdef LIBCUPS_PRESENT
         case 'p': // p to print
-            if ((S_ISREG(current_file_stat.st_mode)) && !(current_file_stat.st_mode & S_IXUSR)) {
-                print_support(str_ptr[active][ps[active].curr_pos]);
+            if (cursor_stat(path, &current_file_stat) == 0 &&
+                (S_ISREG(current_file_stat.st_mode)) && !(current_file_stat.st_mode & S_IXUSR)) {
+                print_support(path);
             }
             break;
 #endif
@@ -389,6 +427,11 @@ static void main_loop(void) {
         case ',': // , to enable fast browse mode
             show_special_tab(ps[active].number_of_files, NULL, ps[active].title, fast_browse_);
             break;
+        case '/': // / to filter current dir files
+            if (ps[active].mode == normal) {
+                show_filter();
+            }
+            break;
         case 27: /* ESC to exit/leave special mode */
             manage_quit();
             break;
@@ -416,6 +459,19 @@ static void main_loop(void) {
         case 'k': // k to show selected files
             show_selected();
             break;
+        case 'j': // j to show jobs
+            show_jobs();
+            break;
+        case 'c': // c to pause/resume a job in jobs mode
+            if (ps[active].mode == jobs_) {
+                pause_viewed_job();
+            }
+            break;
+        case '+': case '-': // +/- to move a job up/down in jobs mode
+            if (ps[active].mode == jobs_) {
+                move_viewed_job(c == '-');
+            }
+            break;
         case KEY_DC: // del to delete all selected files in selected mode/ all user bookmarks in bookmark mode
             if (ps[active].mode == bookmarks_) {
                 check_remove(remove_all_user_bookmarks);
@@ -427,10 +483,12 @@ static void main_loop(void) {
             if(getmouse(&event) == OK) {
                 if (event.bstate & BUTTON1_RELEASED) {
                     /* left click will send an enter event */
-                    manage_enter(current_file_stat);
+                    if (cursor_stat(path, &current_file_stat) == 0) {
+                        manage_enter(current_file_stat);
+                    }
                 } else if (event.bstate & BUTTON2_RELEASED) {
                     /* middle click will send a space event */
-                    manage_space(str_ptr[active][ps[active].curr_pos]);
+                    manage_space(path);
                 } else if (event.bstate & BUTTON3_RELEASED) {
                     /* right click will send a back to root dir event */
                     if (ps[active].mode <= fast_browse_) {
@@ -455,11 +513,13 @@ static void main_loop(void) {
                     if (check_init(index)) {
                         init_thread(index, long_func[index]);
                     }
-                // in mode != normal, only 'r' to remove is accepted while in bookmarks/selected mode
+                // in mode != normal, only 'r' to remove is accepted while in bookmarks/selected/jobs mode
                 } else if (ps[active].mode == bookmarks_) {
                     remove_bookmark_from_file();
                 } else if (ps[active].mode == selected_) {
                     check_remove(remove_selected);
+                } else if (ps[active].mode == jobs_) {
+                    check_remove(cancel_viewed_job);
                 }
             }
             break;
@@ -473,6 +533,45 @@ static void add_new_tab(void) {
     new_tab(cont - 1);
 }
 
+/*
+ * Moves cursor for c (arrow up/down, PG_UP/DOWN) and for every
+ * navigation key already queued after it (eg: a held down arrow key),
+ * up to MAX_NAV_KEYS: they are collapsed into a single cursor move,
+ * so the tab is repainted once. First other key is pushed back.
+ */
+static void manage_navigation(wint_t c) {
+    int pos = ps[active].curr_pos, ret;
+    
+    for (int n = 1; ; n++) {
+        switch (c) {
+        case KEY_UP:
+            pos -= pos > 0;
+            break;
+        case KEY_DOWN:
+            pos += pos < ps[active].number_of_files - 1;
+            break;
+        case KEY_PPAGE:
+            pos = 0;
+            break;
+        case KEY_NPAGE:
+            pos = ps[active].number_of_files - 1;
+            break;
+        }
+        if (n == MAX_NAV_KEYS || (ret = wget_wch(ps[active].mywin.fm, &c)) == ERR) {
+            break;
+        }
+        if (ret != KEY_CODE_YES || (c != KEY_UP && c != KEY_DOWN && c != KEY_PPAGE && c != KEY_NPAGE)) {
+            if (ret == KEY_CODE_YES) {
+                ungetch(c);
+            } else {
+                unget_wch(c);
+            }
+            break;
+        }
+    }
+    move_cursor(active, pos);
+}
+
 #ifdef SYSTEMD_PRESENT
 static void check_device_mode(void) {
     if (device_init == DEVMON_STARTING) {
@@ -487,7 +586,30 @@ static void check_device_mode(void) {
 }
 #endif
 
+/*
+ * Only keys that need to know what's under the cursor stat it (not every keypress):
+ * dir listings already cached entry's mode (unless it is a symlink);
+ * otherwise stat is bounded, not to freeze UI on a hung mount.
+ */
+static int cursor_stat(const char *path, struct stat *st) {
+    if (str_ptr[active] == &ps[active].nl && ps[active].curr_pos < ALL_ENTRIES(&ps[active].nl)) {
+        const struct file_entry *e = &ps[active].nl.entries[ps[active].curr_pos];
+        
+        if (e->stat_state == STAT_CACHED && !S_ISLNK(e->mode)) {
+            st->st_mode = e->mode;
+            return 0;
+        }
+    }
+    if (bounded_stat(path, st, ENTER_STAT_TIMEOUT) == -1 && errno == ETIMEDOUT) {
+        print_info(strerror(errno), ERR_LINE);
+        return -1;
+    }
+    return 0;
+}
+
 static void manage_enter(struct stat current_file_stat) {
+    char path[PATH_MAX + 1];
+    
     if (ps[active].mode == search_) {
         manage_enter_search(current_file_stat);
     }
@@ -496,14 +618,25 @@ static void manage_enter(struct stat current_file_stat) {
         manage_enter_device();
     }
 #endif
-    else if (ps[active].mode == bookmarks_) {
+    else if (ps[active].mode == filter_) {
+        list_fullpath(str_ptr[active], ps[active].curr_pos, path);
+        leave_special_mode(NULL, active);
+        if (S_ISDIR(current_file_stat.st_mode)) {
+            change_dir(path, active);
+        } else {
+            manage_file(path);
+        }
+    } else if (ps[active].mode == bookmarks_) {
         manage_enter_bookmarks(current_file_stat);
     } else if (ps[active].mode == selected_) {
         leave_mode_helper(current_file_stat);
+    } else if (ps[active].mode == jobs_) {
+        // jobs are not files: nothing to open
+        return;
     } else if (S_ISDIR(current_file_stat.st_mode)) {
-        change_dir(str_ptr[active][ps[active].curr_pos], active);
+        change_dir(list_fullpath(str_ptr[active], ps[active].curr_pos, path), active);
     } else {
-        manage_file(str_ptr[active][ps[active].curr_pos]);
+        manage_file(list_fullpath(str_ptr[active], ps[active].curr_pos, path));
     }
 }
 
@@ -511,7 +644,7 @@ static void manage_enter_search(struct stat current_file_stat) {
     char *str = NULL;
     char path[PATH_MAX + 1] = {0};
     
-    strncpy(path, sv.found_searched[ps[active].curr_pos], PATH_MAX);
+    strncpy(path, list_name(&sv.found_searched, ps[active].curr_pos), PATH_MAX);
     if (!S_ISDIR(current_file_stat.st_mode)) {
         int index = search_enter_press(path);
         /* save in str current file's name */
@@ -552,6 +685,17 @@ static void manage_quit(void) {
         leave_special_mode(NULL, active);
         print_info("", INFO_LINE); // clear fast browse string from info line
     } else {
+        if (running_workers()) {
+            char c;
+            
+            ask_user(_(quit_with_jobs), &c, 1);
+            if (c == 27) {
+                return;
+            }
+            if (c == _(yes)[0]) {
+                cancel_all_jobs();
+            }
+        }
         quit = NORM_QUIT;
     }
 }
@@ -578,7 +722,7 @@ static void check_remove(void (*f)(void)) {
 static int check_init(int index) {
     char x;
 
-    if (!selected) {
+    if (!selected.num) {
         print_info(_(no_selected_files), ERR_LINE);
         return 0;
     }
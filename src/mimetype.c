@@ -0,0 +1,170 @@
+#include "../inc/mimetype.h"
+
+/*
+ * A cached mimetype: it is valid as long as file's
+ * dev, inode, mtime (with nanoseconds: a file rewritten within the same second
+ * must be classified again) and size do not change.
+ * used is the value of mime_clock when it was last looked up (0 for empty entries).
+ */
+struct mime_entry {
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    off_t size;
+    unsigned long used;
+    char type[MIMETYPE_LEN];
+};
+
+static magic_t get_magic(void);
+static void make_magic_key(void);
+static void close_magic(void *x);
+static int classify(magic_t magic, const char *path, const struct stat *st, char *type);
+static int cache_lookup(const struct stat *st, char *type);
+static void cache_insert(const struct stat *st, const char *type);
+
+static struct mime_entry mime_cache[MIME_CACHE_SIZE];
+static unsigned long mime_clock;
+static pthread_mutex_t mime_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t magic_key;
+static pthread_once_t magic_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Checks whether path's mimetype contains test string.
+ */
+int get_mimetype(const char *path, const char *test) {
+    char type[MIMETYPE_LEN];
+    
+    if (read_mimetype(path, type) == -1) {
+        return 0;
+    }
+    return strstr(type, test) != NULL;
+}
+
+/*
+ * Copies path's mimetype to type (MIMETYPE_LEN bytes).
+ * Files already classified are found in mime_cache, without touching libmagic.
+ */
+int read_mimetype(const char *path, char *type) {
+    struct stat st;
+    magic_t magic;
+    
+    if (stat(path, &st) == -1) {
+        return -1;
+    }
+    if (cache_lookup(&st, type) == 0) {
+        return 0;
+    }
+    if (!(magic = get_magic())) {
+        return -1;
+    }
+    return classify(magic, path, &st, type);
+}
+
+/*
+ * Closes calling thread's magic handle (other threads' ones
+ * are closed when they exit), and empties mime_cache.
+ */
+void free_mimetypes(void) {
+    pthread_once(&magic_once, make_magic_key);
+    close_magic(pthread_getspecific(magic_key));
+    pthread_setspecific(magic_key, NULL);
+    pthread_mutex_lock(&mime_lock);
+    memset(mime_cache, 0, sizeof(mime_cache));
+    pthread_mutex_unlock(&mime_lock);
+}
+
+/*
+ * libmagic handles cannot be shared between threads:
+ * each thread loads its own one (parsing magic database just once),
+ * the first time it needs it.
+ */
+static magic_t get_magic(void) {
+    magic_t magic;
+    
+    pthread_once(&magic_once, make_magic_key);
+    if ((magic = pthread_getspecific(magic_key))) {
+        return magic;
+    }
+    if ((magic = magic_open(MAGIC_MIME_TYPE)) == NULL) {
+        ERROR("An error occurred while loading libmagic database.");
+        return NULL;
+    }
+    if (magic_load(magic, NULL) == -1) {
+        ERROR("An error occurred while loading libmagic database.");
+        magic_close(magic);
+        return NULL;
+    }
+    pthread_setspecific(magic_key, magic);
+    return magic;
+}
+
+static void make_magic_key(void) {
+    pthread_key_create(&magic_key, close_magic);
+}
+
+static void close_magic(void *x) {
+    if (x) {
+        magic_close((magic_t)x);
+    }
+}
+
+static int classify(magic_t magic, const char *path, const struct stat *st, char *type) {
+    const char *mimetype;
+    
+    if ((mimetype = magic_file(magic, path)) == NULL) {
+        ERROR("An error occurred while loading libmagic database.");
+        return -1;
+    }
+    strncpy(type, mimetype, MIMETYPE_LEN - 1);
+    type[MIMETYPE_LEN - 1] = '\0';
+    cache_insert(st, type);
+    return 0;
+}
+
+static int cache_lookup(const struct stat *st, char *type) {
+    int ret = -1;
+    
+    pthread_mutex_lock(&mime_lock);
+    for (int i = 0; i < MIME_CACHE_SIZE; i++) {
+        struct mime_entry *m = &mime_cache[i];
+        
+        if (m->used && m->ino == st->st_ino && m->dev == st->st_dev
+            && m->mtime.tv_sec == st->st_mtim.tv_sec && m->mtime.tv_nsec == st->st_mtim.tv_nsec
+            && m->size == st->st_size) {
+            m->used = ++mime_clock;
+            strcpy(type, m->type);
+            ret = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mime_lock);
+    return ret;
+}
+
+/*
+ * Stores type in the least recently used entry (or in an old entry
+ * for the same file, whose mtime or size changed).
+ */
+static void cache_insert(const struct stat *st, const char *type) {
+    struct mime_entry *lru = &mime_cache[0];
+    
+    pthread_mutex_lock(&mime_lock);
+    for (int i = 0; i < MIME_CACHE_SIZE; i++) {
+        struct mime_entry *m = &mime_cache[i];
+        
+        if (m->used && m->ino == st->st_ino && m->dev == st->st_dev) {
+            lru = m;
+            break;
+        }
+        if (m->used < lru->used) {
+            lru = m;
+        }
+    }
+    lru->dev = st->st_dev;
+    lru->ino = st->st_ino;
+    lru->mtime = st->st_mtim;
+    lru->size = st->st_size;
+    lru->used = ++mime_clock;
+    strcpy(lru->type, type);
+    pthread_mutex_unlock(&mime_lock);
+}
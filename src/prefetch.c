@@ -0,0 +1,105 @@
+#include "../inc/prefetch.h"
+
+static void cancel_prefetch(void);
+
+/*
+ * hovered: dir the cursor of active tab is resting on (empty if none);
+ * pf_job: job prefetching it.
+ */
+static struct dir_job *pf_job;
+static char hovered[PATH_MAX + 1];
+
+/*
+ * Called by main_poll before reading next input: if active tab's cursor
+ * moved to another file, running prefetch is cancelled; then, if it is on a dir,
+ * prefetch_fd is armed to prefetch it if cursor rests there for PREFETCH_DWELL ms.
+ * Only stats already cached are used.
+ */
+void update_prefetch(void) {
+    char path[PATH_MAX + 1] = {0};
+    const int win = active;
+    
+    if (config.dir_cache_size && ps[win].mode <= filter_ && !ps[win].job && ps[win].curr_pos < ps[win].number_of_files) {
+        const struct file_list *l = str_ptr[win];
+        const struct file_entry *e = &l->entries[ps[win].curr_pos];
+        
+        if (e->stat_state == STAT_CACHED && S_ISDIR(e->mode) && strcmp(list_name(l, ps[win].curr_pos), "..")) {
+            list_fullpath(l, ps[win].curr_pos, path);
+        }
+    }
+    if (!strcmp(path, hovered)) {
+        return;
+    }
+    cancel_prefetch();
+    strcpy(hovered, path);
+    if (strlen(hovered)) {
+        struct itimerspec timer = {{0}};
+        
+        timer.it_value.tv_sec = PREFETCH_DWELL / 1000;
+        timer.it_value.tv_nsec = (PREFETCH_DWELL % 1000) * 1000000;
+        timerfd_settime(prefetch_fd, 0, &timer, NULL);
+    }
+}
+
+/*
+ * Cursor rested on hovered dir: it is listed by a low priority job
+ * (stopped by prefetch_done if an up to date list of it is already available).
+ * Prefetched lists may use at most half of dir cache.
+ */
+void prefetch_timer(int fd) {
+    uint64_t t;
+    
+    read(fd, &t, sizeof(t));
+    if (strlen(hovered) && !pf_job) {
+        pf_job = start_prefetch(hovered, ps[active].show_hidden, ps[active].sorting_index,
+                                (size_t)config.dir_cache_size << 19);
+    }
+}
+
+/*
+ * Called when a dir_job published something:
+ * if it was the prefetch one, its list is moved to dir cache.
+ * As soon as prefetch job stamped its dir, it is stopped if the dir is already cached
+ * (its taken state only marks the stamp as checked: adopt_job resets it).
+ */
+void prefetch_done(void) {
+    if (pf_job) {
+        int state = job_state(pf_job);
+        
+        if (state == LOAD_DONE) {
+            take_prefetch(pf_job);
+            pf_job = NULL;
+        } else if (state != LOAD_RUNNING && pf_job->taken == LOAD_RUNNING) {
+            pf_job->taken = LOAD_STAMPED;
+            if (is_cached(&pf_job->stamp)) {
+                cancel_job(pf_job);
+                pf_job = NULL;
+            }
+        }
+    }
+}
+
+/*
+ * If win is entering the dir being prefetched (with same settings),
+ * prefetch job becomes win's dir_job, even if it is still running.
+ */
+int adopt_prefetch(int win) {
+    if (!pf_job || strcmp(hovered, ps[win].my_cwd) || pf_job->show_hidden != ps[win].show_hidden
+        || pf_job->sorting_index != ps[win].sorting_index || adopt_job(win, pf_job) == -1) {
+        return -1;
+    }
+    pf_job = NULL;
+    return 0;
+}
+
+void free_prefetch(void) {
+    cancel_prefetch();
+}
+
+static void cancel_prefetch(void) {
+    struct itimerspec timer = {{0}};
+    
+    timerfd_settime(prefetch_fd, 0, &timer, NULL);
+    cancel_job(pf_job);
+    pf_job = NULL;
+}
@@ -35,8 +35,13 @@ static void free_everything(void) {
 #endif
     free_timer();
     free(main_p);
+    main_p = NULL;
     free_selected();
     free_bookmarks();
+    free_mimetypes();
+    free_jobs_view();
+    free_prefetch();
+    free_dir_cache();
 }
 
 static void quit_thread_func(void) {
@@ -48,10 +53,10 @@ static void quit_thread_func(void) {
 }
 
 static void quit_worker_th(void) {
-    if ((worker_th) && (pthread_kill(worker_th, 0) != ESRCH)) {
+    if (running_workers()) {
         INFO(quit_with_running_thread);
         printf("%s\n", quit_with_running_thread);
-        pthread_join(worker_th, NULL);
+        wait_job_queue();
         INFO("worker th exited without errors.");
         printf("Jobs queue ended.\n");
     }
@@ -75,13 +80,20 @@ static void quit_search_th(void) {
         pthread_join(search_th, NULL);
         INFO("search th left.");
     }
+    free_list(&sv.found_searched);
 }
 
 static void close_fds(void) {
-    close(ps[0].inot.fd);
-    close(ps[1].inot.fd);
-    close(info_fd[0]);
-    close(info_fd[1]);
+    for (int i = 0; i < MAX_TABS; i++) {
+        if (ps[i].inot.fd != -1) {
+            close(ps[i].inot.fd);
+        }
+    }
+    close(info_fd);
+    close(loader_fd);
+    close(refresh_fd);
+    close(prefetch_fd);
+    close(jobs_fd);
 #if ARCHIVE_VERSION_NUMBER >= 3002000
     close(archive_cb_fd[0]);
     close(archive_cb_fd[1]);
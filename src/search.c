@@ -13,7 +13,7 @@ void search(void) {
     } else {
         char c;
         
-        sv.found_cont = 0;
+        free_list(&sv.found_searched);
         sv.search_archive = 0;
         sv.search_lazy = 0;
         ask_user(_(search_archives), &c, 1);
@@ -61,7 +61,7 @@ static int recursive_search(const char *path, const struct stat *sb, int typefla
     if (sv.search_lazy && fixed_str[0] == '.') {
         return FTW_SKIP_SUBTREE;
     }
-    if ((sv.search_archive) && (is_ext(fixed_str, arch_ext, NUM(arch_ext)))) {
+    if ((sv.search_archive) && IS_ARCHIVE(file_category(fixed_str))) {
         return search_inside_archive(path);
     }
     len = strlen(sv.searched_string);
@@ -71,9 +71,8 @@ static int recursive_search(const char *path, const struct stat *sb, int typefla
         r = 1;
     }
     if (r) {
-        strncpy(sv.found_searched[sv.found_cont], path, PATH_MAX);
-        sv.found_cont++;
-        if (sv.found_cont == MAX_NUMBER_OF_FOUND) {
+        add_to_list(&sv.found_searched, path, typeflag == FTW_D ? DT_DIR : DT_UNKNOWN);
+        if (sv.found_searched.num == MAX_NUMBER_OF_FOUND) {
             ret = FTW_STOP;
         }
     }
@@ -103,9 +102,11 @@ static int search_inside_archive(const char *path) {
                 r = 1;
             }
             if (r) {
-                snprintf(sv.found_searched[sv.found_cont], PATH_MAX, "%s/%s", path, archive_entry_pathname(entry));
-                sv.found_cont++;
-                if (sv.found_cont == MAX_NUMBER_OF_FOUND) {
+                char found[PATH_MAX + 1] = {0};
+                
+                snprintf(found, PATH_MAX, "%s/%s", path, archive_entry_pathname(entry));
+                add_to_list(&sv.found_searched, found, DT_UNKNOWN);
+                if (sv.found_searched.num == MAX_NUMBER_OF_FOUND) {
                     ret = FTW_STOP;
                 }
             }
@@ -126,9 +127,9 @@ static void *search_thread(void *x) {
         char str[100];
         
         INFO("ended recursive search");
-        if ((sv.found_cont == MAX_NUMBER_OF_FOUND) || (sv.found_cont == 0)) {
+        if ((sv.found_searched.num == MAX_NUMBER_OF_FOUND) || (sv.found_searched.num == 0)) {
             sv.searching = NO_SEARCH;
-            if (sv.found_cont == MAX_NUMBER_OF_FOUND) {
+            if (sv.found_searched.num == MAX_NUMBER_OF_FOUND) {
                 print_info(_(too_many_found), INFO_LINE);
                 strncpy(str, _(too_many_found), 100);
             } else {
@@ -137,7 +138,7 @@ static void *search_thread(void *x) {
             }
         } else {
             sv.searching = SEARCHED;
-            snprintf(str, 100, "Search finished, %d files found.", sv.found_cont);
+            snprintf(str, 100, "Search finished, %d files found.", sv.found_searched.num);
         }
         print_info("", SEARCH_LINE);
 #ifdef LIBNOTIFY_PRESENT
@@ -151,8 +152,8 @@ static void *search_thread(void *x) {
 void list_found(void) {
     char str[100];
     
-    sprintf(str, _(search_mode_str), sv.found_cont, sv.searched_string);
-    show_special_tab(sv.found_cont, sv.found_searched, str, search_);
+    sprintf(str, _(search_mode_str), sv.found_searched.num, sv.searched_string);
+    show_special_tab(sv.found_searched.num, &sv.found_searched, str, search_);
     print_info("", SEARCH_LINE);
 }
 
@@ -180,7 +181,7 @@ int search_enter_press(const char *str) {
         strncpy(arch_str, str, PATH_MAX);
         while ((len = strlen(arch_str))) {
             tmp = strrchr(arch_str, '/');
-            if (is_ext(tmp, arch_ext, NUM(arch_ext))) {
+            if (IS_ARCHIVE(file_category(tmp))) {
                 break;
             }
             arch_str[len - strlen(tmp)] = '\0';
@@ -0,0 +1,219 @@
+#include "../inc/selection.h"
+
+static int find_slot(const char *path, uint64_t hash);
+static int insert_slot(uint64_t hash, int idx);
+static void remove_slot(int slot);
+static int rebuild_set(int size);
+
+/*
+ * Hash set of selected files: each slot holds hash of a fullpath
+ * and index of the path inside "selected" list (-1 for empty slots).
+ * FNV-1a hashes (str_hash), open addressing with linear probing; set_size is a power of 2,
+ * kept at least twice the number of selected files.
+ */
+struct sel_slot {
+    uint64_t hash;
+    int idx;
+};
+
+static struct sel_slot *set;
+static int set_size;
+
+/*
+ * Adds path to selected files.
+ * Returns 0, or -1 if it was already selected (or on error).
+ */
+int select_path(const char *path) {
+    uint64_t hash = str_hash(path);
+    int i;
+
+    if (find_slot(path, hash) != -1) {
+        return -1;
+    }
+    if (2 * (selected.num + 1) > set_size && rebuild_set(set_size ? 2 * set_size : SEL_SET_MIN) == -1) {
+        return -1;
+    }
+    if ((i = add_to_list(&selected, path, DT_UNKNOWN)) == -1) {
+        return -1;
+    }
+    return insert_slot(hash, i);
+}
+
+/*
+ * Removes path from selected files, in O(1):
+ * last selected path takes its place in the list,
+ * so only its slot needs to be updated.
+ * Returns 0, or -1 if it was not selected.
+ */
+int unselect_path(const char *path) {
+    int slot = find_slot(path, str_hash(path));
+    int idx, moved;
+
+    if (slot == -1) {
+        return -1;
+    }
+    idx = set[slot].idx;
+    remove_slot(slot);
+    if ((moved = swap_remove_from_list(&selected, idx)) != -1) {
+        const char *moved_path = list_name(&selected, idx);
+        uint64_t hash = str_hash(moved_path);
+
+        for (int i = hash & (set_size - 1); set[i].idx != -1; i = (i + 1) & (set_size - 1)) {
+            if (set[i].idx == moved) {
+                set[i].idx = idx;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Unselects every selected entry among first num entries of l
+ * (eg: listed ones of a tab), clearing their selected flag.
+ * Kept paths are copied to a new "selected" list, and set is rebuilt:
+ * this way it is linear in the number of selected files.
+ */
+void unselect_listed(struct file_list *l, int num) {
+    char path[PATH_MAX + 1];
+    struct file_list kept;
+    char *drop;
+
+    if (!selected.num) {
+        return;
+    }
+    if (!(drop = calloc(selected.num, sizeof(char)))) {
+        quit = MEM_ERR_QUIT;
+        ERROR("could not malloc.");
+        return;
+    }
+    for (int i = 0; i < num; i++) {
+        if (l->entries[i].selected) {
+            int slot = find_slot(list_fullpath(l, i, path), str_hash(path));
+            if (slot != -1) {
+                drop[set[slot].idx] = 1;
+            }
+            l->entries[i].selected = 0;
+        }
+    }
+    init_list(&kept, NULL);
+    for (int i = 0; i < selected.num; i++) {
+        if (!drop[i] && add_to_list(&kept, list_name(&selected, i), DT_UNKNOWN) == -1) {
+            break;
+        }
+    }
+    free(drop);
+    free_list(&selected);
+    selected = kept;
+    rebuild_set(set_size);
+}
+
+int is_selected(const char *path) {
+    return selected.num && find_slot(path, str_hash(path)) != -1;
+}
+
+/*
+ * Updates selected flag of each entry of l (hidden ones too).
+ */
+void sync_selection(struct file_list *l) {
+    char path[PATH_MAX + 1];
+
+    for (int i = 0; i < ALL_ENTRIES(l); i++) {
+        l->entries[i].selected = is_selected(list_fullpath(l, i, path));
+    }
+}
+
+/*
+ * Called once "selected" list has been emptied (or taken by a job):
+ * empties the set and clears selected flag of every tab's entry.
+ */
+void reset_selection(void) {
+    for (int i = 0; i < set_size; i++) {
+        set[i].idx = -1;
+    }
+    for (int i = 0; i < cont; i++) {
+        sync_selection(&ps[i].nl);
+    }
+}
+
+void free_selected(void) {
+    free_list(&selected);
+    free(set);
+    set = NULL;
+    set_size = 0;
+}
+
+/*
+ * Returns slot of path, or -1 if it is not selected.
+ */
+static int find_slot(const char *path, uint64_t hash) {
+    if (!set_size) {
+        return -1;
+    }
+    for (int i = hash & (set_size - 1); set[i].idx != -1; i = (i + 1) & (set_size - 1)) {
+        if (set[i].hash == hash && !strcmp(list_name(&selected, set[i].idx), path)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int insert_slot(uint64_t hash, int idx) {
+    int i = hash & (set_size - 1);
+
+    while (set[i].idx != -1) {
+        i = (i + 1) & (set_size - 1);
+    }
+    set[i].hash = hash;
+    set[i].idx = idx;
+    return 0;
+}
+
+/*
+ * Empties slot, then moves back following slots of the same cluster
+ * that would not be reachable anymore (no tombstones needed).
+ */
+static void remove_slot(int slot) {
+    int i = slot;
+
+    set[slot].idx = -1;
+    for (;;) {
+        i = (i + 1) & (set_size - 1);
+        if (set[i].idx == -1) {
+            return;
+        }
+        int home = set[i].hash & (set_size - 1);
+        // can slot i be moved to the empty slot? Only if its home is not between them.
+        if (((i - home) & (set_size - 1)) >= ((i - slot) & (set_size - 1))) {
+            set[slot] = set[i];
+            set[i].idx = -1;
+            slot = i;
+        }
+    }
+}
+
+/*
+ * Reallocates set with size slots (at least SEL_SET_MIN),
+ * and inserts every selected path again.
+ */
+static int rebuild_set(int size) {
+    struct sel_slot *tmp;
+
+    if (size < SEL_SET_MIN) {
+        size = SEL_SET_MIN;
+    }
+    if (!(tmp = realloc(set, size * sizeof(struct sel_slot)))) {
+        quit = MEM_ERR_QUIT;
+        ERROR("could not malloc.");
+        return -1;
+    }
+    set = tmp;
+    set_size = size;
+    for (int i = 0; i < set_size; i++) {
+        set[i].idx = -1;
+    }
+    for (int i = 0; i < selected.num; i++) {
+        insert_slot(str_hash(list_name(&selected, i)), i);
+    }
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include "../inc/sort.h"
+
+/*
+ * Fixed width key of an entry: idx is its index in the list being sorted.
+ */
+struct sort_key {
+    uint64_t key;
+    int idx;
+};
+
+static int namesort(const void *e1, const void *e2, void *l);
+static int sizesort(const void *e1, const void *e2, void *l);
+static int last_mod_sort(const void *e1, const void *e2, void *l);
+static int typesort(const void *e1, const void *e2, void *l);
+static int type_rank(unsigned char d_type);
+static uint64_t name_key(const char *name);
+static uint64_t primary_key(const struct file_entry *e, int sorting_index);
+static void radix_sort(struct sort_key **keys, struct sort_key **tmp, int n);
+static int idx_namesort(const void *k1, const void *k2, void *l);
+
+int (*const sorting_func[NUM_SORTS])(const void *e1, const void *e2, void *l) = {
+    namesort, sizesort, last_mod_sort, typesort
+};
+
+/*
+ * Sorting callbacks: they only read cached entries data,
+ * l is the file_list being sorted.
+ * List files by name.
+ */
+static int namesort(const void *e1, const void *e2, void *l) {
+    const struct file_entry *f1 = e1, *f2 = e2;
+
+    return strcoll(((struct file_list *)l)->arena + f1->name_off, ((struct file_list *)l)->arena + f2->name_off);
+}
+
+/*
+ * List files by size, biggest first.
+ */
+static int sizesort(const void *e1, const void *e2, void *l) {
+    const struct file_entry *f1 = e1, *f2 = e2;
+
+    if (f1->size != f2->size) {
+        return (f1->size > f2->size) ? -1 : 1;
+    }
+    return namesort(e1, e2, l);
+}
+
+/*
+ * List files by last modified, newest first.
+ */
+static int last_mod_sort(const void *e1, const void *e2, void *l) {
+    const struct file_entry *f1 = e1, *f2 = e2;
+
+    if (f1->mtime != f2->mtime) {
+        return (f1->mtime > f2->mtime) ? -1 : 1;
+    }
+    return namesort(e1, e2, l);
+}
+
+/*
+ * List files by type: dirs, then regular files, then links, then everything else.
+ */
+static int typesort(const void *e1, const void *e2, void *l) {
+    const struct file_entry *f1 = e1, *f2 = e2;
+    int r1 = type_rank(f1->d_type), r2 = type_rank(f2->d_type);
+
+    if (r1 != r2) {
+        return r1 - r2;
+    }
+    return namesort(e1, e2, l);
+}
+
+static int type_rank(unsigned char d_type) {
+    switch (d_type) {
+    case DT_DIR:
+        return 0;
+    case DT_REG:
+        return 1;
+    case DT_LNK:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+/*
+ * Sorts listed entries of l, giving the same order as sorting_func[sorting_index].
+ * Small lists are just qsorted. Otherwise, every entry gets a fixed width key
+ * (first 8 bytes of strxfrm'ed name), keys are LSD radix sorted,
+ * and only runs of equal keys are compared with strcoll.
+ * Then, if needed, a stable radix sort on size/mtime/type key is run on top of it.
+ * If stop gets set, list is left unsorted.
+ * Returns -1 on error.
+ */
+int sort_list(struct file_list *l, int sorting_index, const volatile int *stop) {
+    struct sort_key *keys, *tmp;
+    struct file_entry *sorted;
+    int n = l->num;
+
+    drop_name_index(l);
+    if (n < RADIX_MIN) {
+        qsort_r(l->entries, n, sizeof(struct file_entry), sorting_func[sorting_index], l);
+        return 0;
+    }
+    keys = malloc(n * sizeof(struct sort_key));
+    tmp = malloc(n * sizeof(struct sort_key));
+    if (!keys || !tmp) {
+        free(keys);
+        free(tmp);
+        quit = MEM_ERR_QUIT;
+        ERROR("could not malloc.");
+        return -1;
+    }
+    for (int i = 0; i < n && !STAT_STOPPED(stop); i++) {
+        keys[i].key = name_key(list_name(l, i));
+        keys[i].idx = i;
+    }
+    if (!STAT_STOPPED(stop)) {
+        radix_sort(&keys, &tmp, n);
+        for (int i = 0, j; i < n; i = j) {
+            for (j = i + 1; j < n && keys[j].key == keys[i].key; j++);
+            if (j - i > 1) {
+                qsort_r(&keys[i], j - i, sizeof(struct sort_key), idx_namesort, l);
+            }
+        }
+    }
+    if (sorting_index != SORT_NAME && !STAT_STOPPED(stop)) {
+        for (int i = 0; i < n; i++) {
+            keys[i].key = primary_key(&l->entries[keys[i].idx], sorting_index);
+        }
+        radix_sort(&keys, &tmp, n);
+    }
+    if (!STAT_STOPPED(stop)) {
+        if (!(sorted = malloc(n * sizeof(struct file_entry)))) {
+            free(keys);
+            free(tmp);
+            quit = MEM_ERR_QUIT;
+            ERROR("could not malloc.");
+            return -1;
+        }
+        for (int i = 0; i < n; i++) {
+            sorted[i] = l->entries[keys[i].idx];
+        }
+        memcpy(l->entries, sorted, n * sizeof(struct file_entry));
+        free(sorted);
+    }
+    free(keys);
+    free(tmp);
+    return 0;
+}
+
+/*
+ * First 8 bytes of strxfrm'ed name, as a big endian number:
+ * comparing them gives the same result of strcoll, unless they're equal.
+ */
+static uint64_t name_key(const char *name) {
+    char buf[BUFF_SIZE], *xfrm = buf;
+    uint64_t key = 0;
+    size_t len = strxfrm(buf, name, sizeof(buf));
+
+    if (len >= sizeof(buf) && (xfrm = malloc(len + 1))) {
+        strxfrm(xfrm, name, len + 1);
+    } else if (len >= sizeof(buf)) {
+        // could not malloc: use untransformed name
+        xfrm = (char *)name;
+        len = strlen(name);
+    }
+    for (size_t i = 0; i < 8; i++) {
+        key = (key << 8) | (i < len ? (unsigned char)xfrm[i] : 0);
+    }
+    if (xfrm != buf && xfrm != name) {
+        free(xfrm);
+    }
+    return key;
+}
+
+/*
+ * Keys are built so that ascending order of them is the sorting order:
+ * biggest/newest first, and type rank for type sort.
+ */
+static uint64_t primary_key(const struct file_entry *e, int sorting_index) {
+    switch (sorting_index) {
+    case SORT_SIZE:
+        return UINT64_MAX - (uint64_t)e->size;
+    case SORT_MTIME:
+        // flip sign bit to keep order of negative times
+        return UINT64_MAX - ((uint64_t)e->mtime ^ (1ULL << 63));
+    default:
+        return type_rank(e->d_type);
+    }
+}
+
+/*
+ * Stable LSD radix sort, one byte per pass.
+ * Passes where every key has the same byte (eg: high bytes of sizes) are skipped.
+ * Sorted keys are left in *keys.
+ */
+static void radix_sort(struct sort_key **keys, struct sort_key **tmp, int n) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        int count[256] = {0};
+        int skip = 0;
+
+        for (int i = 0; i < n; i++) {
+            count[((*keys)[i].key >> shift) & 0xff]++;
+        }
+        for (int b = 0; b < 256 && !skip; b++) {
+            skip = count[b] == n;
+        }
+        if (!skip) {
+            struct sort_key *swap;
+
+            for (int b = 0, pos = 0; b < 256; b++) {
+                int c = count[b];
+                count[b] = pos;
+                pos += c;
+            }
+            for (int i = 0; i < n; i++) {
+                (*tmp)[count[((*keys)[i].key >> shift) & 0xff]++] = (*keys)[i];
+            }
+            swap = *keys;
+            *keys = *tmp;
+            *tmp = swap;
+        }
+    }
+}
+
+static int idx_namesort(const void *k1, const void *k2, void *l) {
+    const struct file_list *list = l;
+
+    return strcoll(list_name(list, ((const struct sort_key *)k1)->idx), list_name(list, ((const struct sort_key *)k2)->idx));
+}
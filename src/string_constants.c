@@ -7,8 +7,6 @@ const char generic_error[] = "A generic error occurred. Check log.";
 
 const char *info_win_str[] = {"?: ", "I: ", "E: "};
 
-const char *arch_ext[] = {".tgz", ".tar.gz", ".zip", ".rar", ".xz", ".ar"};
-
 const char *sorting_str[] = {"Files will be sorted alphabetically now.",
                              "Files will be sorted by size now.",
                              "Files will be sorted by last access now.",
@@ -67,8 +65,13 @@ const char *short_msg[] = {"File created.", "Dir created.", "File renamed."};
 
 const char selected_mess[] = "There are selected files.";
 
+const char loading_mess[] = "Loading...";
+
 const char thread_running[] = "There's already an active job. This job will be queued.";
 const char quit_with_running_thread[] = "Queued jobs still running. Waiting...";
+const char quit_with_jobs[] = "There are queued jobs. Cancel them? y/N:> ";
+const char job_cancel_str[] = "Job cancelled.";
+const char *job_state_str[] = {"queued", "running", "paused", "cancelling", "done"};
 
 #ifdef SYSTEMD_PRESENT
 const char pkg_quest[] = "Do you really want to install this package? y/N:> ";
@@ -95,15 +98,23 @@ const char search_mode_str[] = "%d files found searching %s:";
 
 const char selected_mode_str[] = "Selected files:";
 
+const char jobs_mode_str[] = "Jobs:";
+const char no_jobs[] = "There are no jobs.";
+const char scanning_job[] = "scanning";
+const char *copy_method_str[] = {"cloned", "sparse", "copy_file_range", "sendfile", "read/write"};
+
+const char filter_mode_str[] = "Filter: %s";
+const char no_match[] = "No file matches %s.";
+
 const char ac_online[] = "On AC";
 const char power_fail[] = "No power supply info available.";
 
 const char win_too_small[] = "Window too small. Enlarge it.";
 
 #ifdef SYSTEMD_PRESENT
-const int HELPER_HEIGHT[] = {16, 10, 9, 9, 9, 9};
+const int HELPER_HEIGHT[] = {17, 10, 7, 9, 9, 9, 9, 7};
 #else
-const int HELPER_HEIGHT[] = {14, 9, 9, 9, 9, 9};
+const int HELPER_HEIGHT[] = {16, 9, 7, 9, 9, 9, 9, 7};
 #endif
 
 const char helper_title[] = "Press 'L' to trigger helper";
@@ -117,6 +128,7 @@ const char helper_string[][16][150] =
         {"It will eventually (un)mount your ISO files or install your distro downloaded packages."},
 #endif
         {"%,%enable fast browse mode: it lets you jump between files by just typing their name."},
+        {"%/%enable filter mode: it shows only files matching what you type."},
         {"%PG_UP/DOWN%jump straight to first/last file.%I%check files fullname."},
         {"%H%trigger the showing of hidden files.%S%see files stats."},
         {"%TAB%change sorting function: alphabetically (default), by size, by last modified or by type."},
@@ -130,7 +142,9 @@ const char helper_string[][16][150] =
         {"%T%create second tab.%W%close second tab.%ARROW KEYS%switch between tabs."},
         {"%G%switch to bookmarks mode.%E%add/remove current file to bookmarks."},
 #ifdef SYSTEMD_PRESENT
-        {"%M%switch to device mode.%K%switch to selected mode."},
+        {"%M%switch to device mode.%K%switch to selected mode.%J%switch to jobs mode."},
+#else
+        {"%K%switch to selected mode.%J%switch to jobs mode."},
 #endif
         {"%ESC%quit."}
     }, {
@@ -144,6 +158,12 @@ const char helper_string[][16][150] =
         {"%PG_UP/DOWN%jump straight to first/last file."},
         {"%TAB%change sorting function: alphabetically (default), by size, by last modified or by type."},
         {"%ESC%leave fast browse mode."}
+    }, {
+        {"Just start typing to show only files whose name contains typed text (case insensitive)."},
+        {"Start it with ~ to match typed chars in order, or use *?[ chars for a glob pattern."},
+        {"%BACKSPACE%remove last typed char.%PG_UP/DOWN%jump straight to first/last file."},
+        {"%ENTER%surf to the folder or open the file selected.%ARROW KEYS%switch between tabs."},
+        {"%ESC%leave filter mode."}
     }, {
         {"Remember: every shortcut in ncursesFM is case insensitive."},
         {"%S%see files stats.%I%check files fullname."},
@@ -175,5 +195,11 @@ const char helper_string[][16][150] =
         {"%R%remove current file selection.%DEL%remove all selected files."},
         {"%ENTER%move to the folder/file selected."},
         {"%ESC%leave selected mode."}
+    }, {
+        {"Remember: every shortcut in ncursesFM is case insensitive."},
+        {"%PG_UP/DOWN%jump straight to first/last job.%ARROW KEYS%switch between tabs."},
+        {"%R%cancel current job.%C%pause/resume current job."},
+        {"%+/-%move current job up/down in the queue: upper jobs start first."},
+        {"%ESC%leave jobs mode."}
     }
 };
@@ -1,24 +1,26 @@
 #include "../inc/ui.h"
+#include "../inc/worker_thread.h"
 
 static void info_win_init(void);
-static void generate_list(int win);
-static int sizesort(const struct dirent **d1, const struct dirent **d2);
-static int last_mod_sort(const struct dirent **d1, const struct dirent **d2);
-static int typesort(const struct dirent **d1, const struct dirent **d2);
+static int generate_list(int win);
 static void list_everything(int win, int old_dim, int end);
+static void draw_row(int win, int i);
+static void format_stat(int win, int i, const struct file_entry *e, struct row_cache *r);
+static int grow_rows(int win);
+static void invalidate_rows(int win, int from);
 static void print_arrow(int win);
 static void check_active(int win);
 static void print_border_and_title(int win);
-static int is_hidden(const struct dirent *current_file);
 static void initialize_tab_cwd(int win);
 static void scroll_helper_func(int x, int direction, int win);
-static void colored_folders(WINDOW *win, const char *name);
+static attr_t colored_folders(WINDOW *win, const char *name, const struct file_entry *e);
+static attr_t entry_color(const char *name, const struct file_entry *e);
 static void helper_print(void);
 static void helper_print_color(const int y);
 static void trigger_show_additional_win(int height, WINDOW **win, void (*f)(void));
 static void create_additional_win(int height, WINDOW **win, void (*f)(void));
 static void remove_additional_win(int height, WINDOW **win, int resizing);
-static void show_stat(int init, int end, int win);
+static void update_total_size(int win);
 static void erase_stat(void);
 static void info_print(const char *str, int i);
 static void fix_input_cursor_pos(void);
@@ -27,28 +29,49 @@ static void archiver_cb_func(void);
 #endif
 static void sig_handler(int fd);
 static void info_refresh(int fd);
+static void loader_refresh(int fd);
+static void restore_old_pos(int win);
 static void inotify_refresh(int win);
+static void patch_entries(int win, struct file_list *names);
+static void restat_entry(int win, const char *name, struct file_list *moved);
+static void redraw_from(int win, int idx);
+static void mark_dirty(int win, int flag, int row);
+static void schedule_refresh(void);
+static void refresh_pending(int fd);
 static int print_additional_wins(int helper_height, int resizing);
 static void resize_fm_win(void);
-static void check_selected(const char *str, int win, int line);
 static int check_sysinfo_where(int where, int len);
 static void fullname_print(void);
 static void update_fullname_win(void);
 
 /*
- * struct written to the pipe2.
+ * Latest message printed to an info line, not yet read by main thread if dirty.
  */
-struct info_msg {
-    char *msg;
-    uint8_t line;
+struct info_slot {
+    int dirty;
+    char msg[INFO_MSG_LEN];
 };
 
 static WINDOW *helper_win, *info_win, *fullname_win;
-static int dim, hidden, fullname_win_height, input_mode, input_cursor_pos;
+static int dim, fullname_win_height, input_mode, input_cursor_pos;
+/*
+ * Info messages: one slot for each info line, written by any thread
+ * and read by main thread, both with info_lock held.
+ * A newer message overwrites the one still pending for the same line: it is never dropped.
+ * info_signalled is set while info_fd has already been written and not yet read.
+ */
+static struct info_slot info_slots[INFO_HEIGHT];
+static pthread_mutex_t info_lock = PTHREAD_MUTEX_INITIALIZER;
+static int info_signalled;
+/*
+ * Refresh scheduler status: info messages waiting to be printed (one for each line),
+ * whether refresh_fd is armed, and when last refresh pass happened.
+ */
+static char pending_info[INFO_HEIGHT][INFO_MSG_LEN];
+static int pending_lines;
+static int refresh_armed;
+static struct timespec last_refresh;
 size_t input_len;
-static int (*const sorting_func[])(const struct dirent **d1, const struct dirent **d2) = {
-    alphasort, sizesort, last_mod_sort, typesort
-};
 
 /*
  * Initializes screen, colors etc etc.
@@ -62,6 +85,7 @@ void screen_init(void) {
     init_pair(3, COLOR_GREEN, -1);
     init_pair(4, COLOR_YELLOW, -1);
     init_pair(5, COLOR_RED, -1);
+    init_file_colors();
     noecho();
     curs_set(0);
     mouseinterval(0);
@@ -104,6 +128,7 @@ void screen_end(void) {
          * while we're leaving/we left the program.
          */
         info_win = NULL;
+        pending_lines = 0;
         if (helper_win) {
             delwin(helper_win);
         }
@@ -116,73 +141,62 @@ void screen_end(void) {
 }
 
 /*
- * Creates a list of strings from current win path's files and print them to screen (list_everything)
+ * Caches list of the dir being left (cache_listing).
+ * If current win path is being prefetched, prefetch job is adopted;
+ * otherwise a dir_job starts listing it (it opens it, sets up its inotify watch,
+ * caches stats and sorts it): main thread never touches the dir itself.
+ * Waits at most config.loading_timeout ms for it, and prints it to screen (list_everything).
+ * As soon as job stamped the dir, an up to date list of it cached (or shown in the other tab)
+ * is used as it is (take_listing).
+ * If listing is not ready yet (eg: a slow mount), only ".." is shown,
+ * to let user leave; lists will be printed by loader_refresh when ready.
+ * For big dirs, a first list with only its visible part sorted is shown.
+ * Returns -1 if dir could not be opened.
  * If program cannot allocate memory, it will leave.
  */
-static void generate_list(int win) {
-    struct dirent **files;
+static int generate_list(int win) {
+    int state = LOAD_RUNNING;
     
-    hidden = ps[win].show_hidden;
-    ps[win].number_of_files = scandir(ps[win].my_cwd, &files, is_hidden, sorting_func[ps[win].sorting_index]);
-    free(ps[win].nl);
-    if (!(ps[win].nl = calloc(ps[win].number_of_files, PATH_MAX))) {
-        quit = MEM_ERR_QUIT;
-        ERROR("could not malloc. Leaving.");
-    }
-    str_ptr[win] = ps[win].nl;
-    for (int i = 0; i < ps[win].number_of_files; i++) {
-        if (!quit) {
-            snprintf(ps[win].nl[i], PATH_MAX, "%s/%s", ps[win].my_cwd, files[i]->d_name);
+    cache_listing(win);
+    stop_listing(win);
+    drop_tab_watch(win);
+    free_list(&ps[win].changed);
+    free_list(&ps[win].modified);
+    free_list(&ps[win].nl);
+    init_list(&ps[win].nl, ps[win].my_cwd);
+    memset(&ps[win].stamp, 0, sizeof(ps[win].stamp));
+    str_ptr[win] = &ps[win].nl;
+    if (adopt_prefetch(win) == 0 || start_listing(win, ps[win].sorting_index, dim - 2) == 0) {
+        if ((state = wait_listing(win, config.loading_timeout)) == -1) {
+            add_to_list(&ps[win].nl, "..", DT_DIR);
         }
-        free(files[i]);
     }
-    free(files);
+    ps[win].number_of_files = ps[win].nl.num;
     if (!quit) {
         reset_win(win);
     }
+    return state == LOAD_FAILED ? -1 : 0;
 }
 
 /*
- * Callback function to scandir: list files by size.
- */
-static int sizesort(const struct dirent **d1, const struct dirent **d2) {
-    struct stat stat1, stat2;
-    float result;
-
-    stat((*d1)->d_name, &stat1);
-    stat((*d2)->d_name, &stat2);
-    result = stat1.st_size - stat2.st_size;
-    return (result > 0) ? -1 : 1;
-}
-
-/*
- * Callback function to scandir: list files by last modified.
+ * Makes inot (taken from a dir_job) win's inotify watch, polled by main_poll.
  */
-static int last_mod_sort(const struct dirent **d1, const struct dirent **d2) {
-    struct stat stat1, stat2;
-
-    stat((*d1)->d_name, &stat1);
-    stat((*d2)->d_name, &stat2);
-    return (stat2.st_mtime - stat1.st_mtime);
+void set_tab_watch(int win, const struct inotify *inot) {
+    drop_tab_watch(win);
+    ps[win].inot = *inot;
+    main_p[INOTIFY_IX1 + win].fd = inot->fd;
 }
 
-/*
- * Callback function to scandir: list files by type.
- */
-static int typesort(const struct dirent **d1, const struct dirent **d2) {
-    int ret;
-
-    if ((*d1)->d_type == (*d2)->d_type) {
-        return alphasort(d1, d2);
+void drop_tab_watch(int win) {
+    if (ps[win].inot.fd != -1) {
+        close(ps[win].inot.fd);
     }
-    if ((*d1)->d_type == DT_DIR) {
-        ret = -1;
-    } else if (((*d1)->d_type == DT_REG) && ((*d2)->d_type == DT_LNK)) {
-        ret = -1;
-    } else {
-        ret = 1;
+    ps[win].inot.fd = -1;
+    ps[win].inot.wd = -1;
+    // main_p is already freed while quitting
+    if (main_p) {
+        main_p[INOTIFY_IX1 + win].fd = -1;
     }
-    return ret;
 }
 
 /*
@@ -190,7 +204,9 @@ static int typesort(const struct dirent **d1, const struct dirent **d2) {
  * then call list_everything.
  */
 void reset_win(int win) {
-    wclear(ps[win].mywin.fm);
+    ps[win].mywin.dirty = 0;
+    werase(ps[win].mywin.fm);
+    invalidate_rows(win, 0);
     ps[win].mywin.delta = 0;
     ps[win].curr_pos = 0;
     memset(ps[win].mywin.tot_size, 0, strlen(ps[win].mywin.tot_size));
@@ -202,32 +218,135 @@ void reset_win(int win) {
  * If end == 0, it means it needs to print every string until the end of available rows,
  * If stat_active == STATS_ON for 'win', and 'win' is not in special_mode, 
  * it prints stats about size and permissions for every file.
+ * Rows are drawn through draw_row: unchanged ones are skipped.
  */
 static void list_everything(int win, int old_dim, int end) {
-    char *str;
-    
-    wattron(ps[win].mywin.fm, A_BOLD);
     for (int i = old_dim; (i < ps[win].number_of_files) && (i  < old_dim + end); i++) {
-        wmove(ps[win].mywin.fm, i + 1 - ps[win].mywin.delta, 1);
-        wclrtoeol(ps[win].mywin.fm);
-        if (ps[win].mode > fast_browse_) {
-            str = str_ptr[win][i];
-        } else {
-            check_selected(str_ptr[win][i], win, i);
-            str = strrchr(str_ptr[win][i], '/') + 1;
-        }
-        colored_folders(ps[win].mywin.fm, *(str_ptr[win] + i));
-        mvwprintw(ps[win].mywin.fm, 1 + i - ps[win].mywin.delta, 4, "%.*s", ps[win].mywin.width - 5, str);
-        wattroff(ps[win].mywin.fm, COLOR_PAIR);
+        draw_row(win, i);
     }
-    wattroff(ps[win].mywin.fm, A_BOLD);
     if (ps[win].mywin.stat_active) {
-        show_stat(old_dim, end, win);
+        update_total_size(win);
     }
     print_arrow(win);
     print_border_and_title(win);
 }
 
+/*
+ * Draws i-th file of win's list in its row, comparing it with row cache first:
+ * nothing is drawn if row did not change, and only the selection mark
+ * if it is the only thing that changed.
+ * Row is cleared up to the right border, that is never touched.
+ */
+static void draw_row(int win, int i) {
+    WINDOW *fm = ps[win].mywin.fm;
+    const int row = i - ps[win].mywin.delta;
+    struct row_cache r = {0}, *old;
+    const struct file_entry *e;
+    
+    if (row < 0 || row >= dim - 2 || grow_rows(win) == -1) {
+        return;
+    }
+    e = list_stat(str_ptr[win], i);
+    old = &ps[win].mywin.rows[row];
+    r.valid = 1;
+    r.selected = ps[win].mode <= fast_browse_ && e->selected;
+    r.color = entry_color(list_name(str_ptr[win], i), e);
+    // special modes lists have no prefix: their names are fullpaths.
+    snprintf(r.name, sizeof(r.name), "%.*s", ps[win].mywin.width - 5, list_name(str_ptr[win], i));
+    // jobs mode always shows jobs' state
+    if (ps[win].mywin.stat_active || ps[win].mode == jobs_) {
+        format_stat(win, i, e, &r);
+    }
+    if (old->valid && old->color == r.color && old->stat_col == r.stat_col && !strcmp(old->name, r.name)
+        && !strcmp(old->stat, r.stat) && !strcmp(old->perm, r.perm)) {
+        if (old->selected != r.selected) {
+            wattron(fm, A_BOLD);
+            mvwprintw(fm, row + 1, SEL_COL, "%c", r.selected ? '*' : ' ');
+            wattroff(fm, A_BOLD);
+            old->selected = r.selected;
+        }
+        return;
+    }
+    // blanks must have no attributes, or terminal could not clear them with a single escape
+    mvwhline(fm, row + 1, SEL_COL, ' ', ps[win].mywin.width - 1 - SEL_COL);
+    wattron(fm, A_BOLD);
+    if (r.selected) {
+        mvwprintw(fm, row + 1, SEL_COL, "*");
+    }
+    wattron(fm, r.color);
+    mvwprintw(fm, row + 1, 4, "%s", r.name);
+    wattroff(fm, r.color);
+    wattroff(fm, A_BOLD);
+    if (strlen(r.stat)) {
+        mvwprintw(fm, row + 1, r.stat_col, "%.*s", ps[win].mywin.width - 1 - r.stat_col, r.stat);
+    }
+    if (strlen(r.perm)) {
+        mvwprintw(fm, row + 1, ps[win].mywin.width - PERM_LENGTH, "%s", r.perm);
+    }
+    *old = r;
+}
+
+/*
+ * Writes stats of i-th file of win's list into row r:
+ * its size and permissions (from cached stats), device info in device mode,
+ * or job's state in jobs mode.
+ */
+static void format_stat(int win, int i, const struct file_entry *e, struct row_cache *r) {
+    const int perm_bit[9] = {S_IRUSR, S_IWUSR, S_IXUSR, S_IRGRP, S_IWGRP, S_IXGRP, S_IROTH, S_IWOTH, S_IXOTH};
+    const char perm_sign[3] = {'r', 'w', 'x'};
+    
+    if (ps[win].mode == device_) {
+#ifdef SYSTEMD_PRESENT
+        show_devices_stat(i, win, r->stat);
+        r->stat_col = ps[win].mywin.width - strlen(r->stat) - 1;
+        if (r->stat_col < 0) {
+            r->stat_col = 4;
+        }
+#endif
+    } else if (ps[win].mode == jobs_) {
+        show_jobs_stat(i, r->stat);
+        r->stat_col = ps[win].mywin.width - strlen(r->stat) - 1;
+        if (r->stat_col < 0) {
+            r->stat_col = 4;
+        }
+    } else if (e->stat_state == STAT_CACHED) {
+        change_unit(e->size, r->stat);
+        r->stat_col = ps[win].mywin.width - STAT_LENGTH;
+        for (int j = 0; j < 9; j++) {
+            r->perm[j] = (e->mode & perm_bit[j]) ? perm_sign[j % 3] : '-';
+        }
+    }
+}
+
+/*
+ * Makes room in win's row cache for every visible row.
+ */
+static int grow_rows(int win) {
+    if (ps[win].mywin.num_rows < dim - 2) {
+        struct row_cache *tmp = realloc(ps[win].mywin.rows, (dim - 2) * sizeof(struct row_cache));
+        if (!tmp) {
+            quit = MEM_ERR_QUIT;
+            ERROR("could not malloc.");
+            return -1;
+        }
+        ps[win].mywin.rows = tmp;
+        for (int i = ps[win].mywin.num_rows; i < dim - 2; i++) {
+            ps[win].mywin.rows[i].valid = 0;
+        }
+        ps[win].mywin.num_rows = dim - 2;
+    }
+    return 0;
+}
+
+/*
+ * Forgets content of win's rows from "from" on (eg: after they were erased).
+ */
+static void invalidate_rows(int win, int from) {
+    for (int i = from < 0 ? 0 : from; i < ps[win].mywin.num_rows; i++) {
+        ps[win].mywin.rows[i].valid = 0;
+    }
+}
+
 static void print_arrow(int win) {
     check_active(win);
     mvwprintw(ps[win].mywin.fm, 1 + ps[win].curr_pos - ps[win].mywin.delta, 1, "%ls", config.cursor_chars);
@@ -254,27 +373,20 @@ static void check_active(int win) {
  */
 static void print_border_and_title(int win) {
     if (ps[win].mywin.fm) {
+        const char *corner = ps[win].mywin.tot_size;
+        
+        // while dir is being listed, show it instead of total size
+        if (ps[win].job && ps[win].mode <= fast_browse_) {
+            corner = _(loading_mess);
+        }
         check_active(win);
         wborder(ps[win].mywin.fm, 0, 0, 0, 0, 0, 0 , 0 , 0);
         mvwprintw(ps[win].mywin.fm, 0, 0, "%.*s", ps[win].mywin.width - 1, _(ps[win].title));
-        mvwprintw(ps[win].mywin.fm, 0, ps[win].mywin.width - strlen(ps[win].mywin.tot_size), ps[win].mywin.tot_size);
+        mvwprintw(ps[win].mywin.fm, 0, ps[win].mywin.width - strlen(corner), corner);
         wattroff(ps[win].mywin.fm, COLOR_PAIR);
         wattroff(ps[win].mywin.fm, A_BOLD);
-        wrefresh(ps[win].mywin.fm);
-    }
-}
-
-/*
- * Helper function passed to scandir (in generate_list() )
- * Will return false for '.', and for every file starting with '.' (except for '..') if !show_hidden
- */
-static int is_hidden(const struct dirent *current_file) {
-    if (current_file->d_name[0] == '.') {
-        if ((strlen(current_file->d_name) == 1) || ((!hidden) && current_file->d_name[1] != '.')) {
-            return (FALSE);
-        }
+        wnoutrefresh(ps[win].mywin.fm);
     }
-    return (TRUE);
 }
 
 /*
@@ -296,6 +408,7 @@ void new_tab(int win) {
  */
 void resize_tab(int win, int resizing) {
     wclear(ps[win].mywin.fm);
+    invalidate_rows(win, 0);
     ps[win].mywin.width = COLS / cont + win * (COLS % cont);
     wresize(ps[win].mywin.fm, dim, ps[win].mywin.width);
     mvwin(ps[win].mywin.fm, 0, (COLS * win) / cont);
@@ -311,18 +424,25 @@ void resize_tab(int win, int resizing) {
 
 /*
  * Helper function for new_tab().
- * Calculates new tab's cwd and saves new tab's title.
- * Add an inotify_watcher on the new tab's cwd.
- * Then refreshes UI.
+ * Calculates new tab's cwd (by default, active tab's one; first tab starts from
+ * process cwd, that never changes) and saves new tab's title.
+ * Then refreshes UI (its dir_job adds an inotify watcher on the new tab's cwd).
  */
 static void initialize_tab_cwd(int win) {
+    char cwd[PATH_MAX + 1] = "/";
+    
+    if (win != active && strlen(ps[active].my_cwd)) {
+        strncpy(cwd, ps[active].my_cwd, PATH_MAX);
+    } else {
+        getcwd(cwd, PATH_MAX);
+    }
     if (strlen(config.starting_dir)) {
         if ((cont == 1) || (config.second_tab_starting_dir)) {
-            strncpy(ps[win].my_cwd, config.starting_dir, PATH_MAX);
+            make_path(cwd, config.starting_dir, ps[win].my_cwd);
         }
     }
     if (!strlen(ps[win].my_cwd)) {
-        getcwd(ps[win].my_cwd, PATH_MAX);
+        strncpy(ps[win].my_cwd, cwd, PATH_MAX);
     }
     ps[win].old_file[0] = 0;
     ps[win].show_hidden = config.show_hidden;
@@ -342,10 +462,18 @@ void delete_tab(int win) {
     memset(ps[win].my_cwd, 0, sizeof(ps[win].my_cwd));
     memset(ps[win].mywin.tot_size, 0, strlen(ps[win].mywin.tot_size));
     ps[win].mywin.stat_active = 0;
+    ps[win].mywin.dirty = 0;
     ps[win].mode = normal;
-    free(ps[win].nl);
-    inotify_rm_watch(ps[win].inot.fd, ps[win].inot.wd);
-    ps[win].nl = NULL;
+    stop_listing(win);
+    free_list(&ps[win].changed);
+    free_list(&ps[win].modified);
+    free_list(&ps[win].nl);
+    free_list(&ps[win].filtered);
+    memset(ps[win].filter_str, 0, sizeof(ps[win].filter_str));
+    free(ps[win].mywin.rows);
+    ps[win].mywin.rows = NULL;
+    ps[win].mywin.num_rows = 0;
+    drop_tab_watch(win);
 }
 
 void scroll_down(int win, int lines) {
@@ -370,8 +498,35 @@ void scroll_down(int win, int lines) {
     } else {
         // no need to reprint anything as we did not scroll down our win
         print_arrow(win);
-        wrefresh(ps[win].mywin.fm);
+        wnoutrefresh(ps[win].mywin.fm);
+    }
+}
+
+/*
+ * Moves win's cursor straight to idx.
+ * Near jumps just scroll; far ones show idx as last row (if moving down)
+ * or as first row (if moving up), redrawing only the visible rows.
+ */
+void move_cursor(int win, int idx) {
+    int old_pos = ps[win].curr_pos;
+    
+    if (abs(idx - old_pos) < dim - 2) {
+        if (idx > old_pos) {
+            scroll_down(win, idx - old_pos);
+        } else {
+            scroll_up(win, old_pos - idx);
+        }
+        return;
     }
+    ps[win].curr_pos = idx;
+    if (idx > old_pos) {
+        ps[win].mywin.delta = idx - (dim - 3) > 0 ? idx - (dim - 3) : 0;
+    } else {
+        ps[win].mywin.delta = idx;
+    }
+    werase(ps[win].mywin.fm);
+    invalidate_rows(win, 0);
+    list_everything(win, ps[win].mywin.delta, dim - 2);
 }
 
 void scroll_up(int win, int lines) {
@@ -396,35 +551,56 @@ void scroll_up(int win, int lines) {
     } else {
         // no need to reprint anything as we did not scroll up our win
         print_arrow(win);
-        wrefresh(ps[win].mywin.fm);
+        wnoutrefresh(ps[win].mywin.fm);
     }
 }
 
+/*
+ * Scrolls win by direction rows (up if positive), and its row cache with it:
+ * rows scrolled in are blank.
+ */
 static void scroll_helper_func(int x, int direction, int win) {
+    struct row_cache *rows = ps[win].mywin.rows;
+    int n = ps[win].mywin.num_rows < dim - 2 ? ps[win].mywin.num_rows : dim - 2;
+    
     mvwprintw(ps[win].mywin.fm, x, 1, "  ");
     wborder(ps[win].mywin.fm, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
     wscrl(ps[win].mywin.fm, direction);
+    if (abs(direction) >= n) {
+        invalidate_rows(win, 0);
+    } else if (direction > 0) {
+        memmove(rows, rows + direction, (n - direction) * sizeof(struct row_cache));
+        invalidate_rows(win, n - direction);
+    } else if (direction < 0) {
+        memmove(rows - direction, rows, (n + direction) * sizeof(struct row_cache));
+        for (int i = 0; i < -direction; i++) {
+            rows[i].valid = 0;
+        }
+    }
 }
 
 /*
- * Follows ls color scheme to color files/folders.
+ * Follows ls color scheme (LS_COLORS, if set) to color files/folders.
  * In search mode, it highlights paths inside archives in yellow.
  * In device mode, everything is printed in yellow.
+ * It only uses entry's cached stats.
+ * Returns attributes turned on.
  */
-static void colored_folders(WINDOW *win, const char *name) {
-    struct stat file_stat;
-
-    if (lstat(name, &file_stat) == 0) {
-        if (S_ISDIR(file_stat.st_mode)) {
-            wattron(win, COLOR_PAIR(1));
-        } else if (S_ISLNK(file_stat.st_mode)) {
-            wattron(win, COLOR_PAIR(2));
-        } else if ((S_ISREG(file_stat.st_mode)) && (file_stat.st_mode & S_IXUSR)) {
-            wattron(win, COLOR_PAIR(3));
-        }
-    } else {
-        wattron(win, COLOR_PAIR(4));
+static attr_t colored_folders(WINDOW *win, const char *name, const struct file_entry *e) {
+    attr_t attr = entry_color(name, e);
+    
+    wattron(win, attr);
+    return attr;
+}
+
+/*
+ * Returns attributes (color pair included) of entry.
+ */
+static attr_t entry_color(const char *name, const struct file_entry *e) {
+    if (e->stat_state != STAT_CACHED) {
+        return COLOR_PAIR(4);
     }
+    return file_color(name, e->mode);
 }
 
 static void trigger_show_additional_win(int height, WINDOW **win, void (*f)(void)) {
@@ -449,6 +625,7 @@ static void create_additional_win(int height, WINDOW **win, void (*f)(void)) {
     dim -= height;
     for (int i = 0; i < cont; i++) {
         wresize(ps[i].mywin.fm, dim, ps[i].mywin.width);
+        invalidate_rows(i, dim - 2);
         if (ps[i].curr_pos > dim - 3 + ps[i].mywin.delta) {
             int delta = ps[i].curr_pos - (dim - 3 + ps[i].mywin.delta);
             ps[i].curr_pos = dim - 3 + ps[i].mywin.delta;
@@ -475,6 +652,7 @@ static void remove_additional_win(int height, WINDOW **win, int resizing) {
     for (int i = 0; i < cont; i++) {
         mvwhline(ps[i].mywin.fm, dim - 1 - height, 0, ' ', COLS);
         wresize(ps[i].mywin.fm, dim, ps[i].mywin.width);
+        invalidate_rows(i, dim - 2 - height);
         if (!resizing) {
             list_everything(i, dim - 2 - height + ps[i].mywin.delta, height);
         }
@@ -541,71 +719,27 @@ static void helper_print(void) {
 }
 
 /*
- * init: from where to print stats.
- * end: how many files' stats we need to print. (0 means all)
- * win: window where we need to print.
- * Prints size and perms for each of the files of the win between init and init + end.
- * Plus, calculates full folder size if ps[win].mywin.tot_size is empty (it is emptied in generate_list,
+ * Calculates full folder size if ps[win].mywin.tot_size is empty (it is emptied in generate_list,
  * so it will be empty only when a full redraw of the win is needed).
+ * Special modes lists have no total size.
+ * Everything is read from list's cached stats.
  */
-static void show_stat(int init, int end, int win) {
-    int check = strlen(ps[win].mywin.tot_size);
-    const int perm_bit[9] = {S_IRUSR, S_IWUSR, S_IXUSR, S_IRGRP, S_IWGRP, S_IXGRP, S_IROTH, S_IWOTH, S_IXOTH};
-    const char perm_sign[3] = {'r', 'w', 'x'};
+static void update_total_size(int win) {
     char str[100] = {0};
-    float total_size = 0;
-    struct stat file_stat;
-    const int perm_col = ps[win].mywin.width - PERM_LENGTH;
-    const int size_col = ps[win].mywin.width - STAT_LENGTH;
-    int col;
+    off_t total_size = 0;
     
-    if (ps[win].mode <= fast_browse_) {
-        check %= check - 1; // "check" should be 0 or 1 (strlen(tot_size) will never be 1, so i can safely divide for check - 1)
-    } else {
-        check = 1;  // if we're in special mode, we don't need printing total size.
+    if (ps[win].mode > fast_browse_ || strlen(ps[win].mywin.tot_size)) {
+        return;
     }
-    for (int i = check * init; i < ps[win].number_of_files; i++) {
-        if (stat(str_ptr[win][i], &file_stat) == -1 && ps[win].mode != device_) {
-            continue;
-        }
-        if (!check) {
-            total_size += file_stat.st_size;
-        }
-        if ((i >= init) && (i < init + end)) {
-            if (ps[win].mode == device_) {
-#ifdef SYSTEMD_PRESENT
-                show_devices_stat(i, win, str);
-                col = ps[win].mywin.width - strlen(str) - 1;
-                if (col < 0) {
-                    col = 4;
-                }
-#endif
-            } else {
-                col = size_col;
-                change_unit(file_stat.st_size, str);
-            }
-            // if show_devices_stat returned a non-empty string
-            // or we are not in device_mode
-            if (strlen(str)) {
-                wmove(ps[win].mywin.fm, i + 1 - ps[win].mywin.delta, col);
-                wclrtoeol(ps[win].mywin.fm);
-                mvwprintw(ps[win].mywin.fm, i + 1 - ps[win].mywin.delta, col, "%.*s", ps[win].mywin.width - 5, str);
-            }
-            if (ps[win].mode != device_) {
-                for (int j = 0; j < 9; j++) {
-                    mvwprintw(ps[win].mywin.fm, i + 1 - ps[win].mywin.delta, perm_col + j, 
-                              (file_stat.st_mode & perm_bit[j]) ? "%c" : "-", perm_sign[j % 3]);
-                }
-            }
-            if ((i == init + end - 1) && (check)) {
-                break;
-            }
+    for (int i = 0; i < ps[win].number_of_files; i++) {
+        const struct file_entry *e = list_stat(str_ptr[win], i);
+        if (e->stat_state == STAT_CACHED) {
+            total_size += e->size;
         }
     }
-    if (!check) {
-        change_unit(total_size, str);
-        sprintf(ps[win].mywin.tot_size, "Total size: %s", str);
-    }
+    ps[win].mywin.tot_bytes = total_size;
+    change_unit(total_size, str);
+    sprintf(ps[win].mywin.tot_size, "Total size: %s", str);
 }
 
 /*
@@ -615,7 +749,7 @@ static void show_stat(int init, int end, int win) {
 void trigger_stats(void) {
     ps[active].mywin.stat_active = !ps[active].mywin.stat_active;
     if (ps[active].mywin.stat_active) {
-        show_stat(ps[active].mywin.delta, dim - 2, active);
+        list_everything(active, ps[active].mywin.delta, dim - 2);
     } else {
         erase_stat();
     }
@@ -637,7 +771,7 @@ static void erase_stat(void) {
  * (eg: "Pasting..." while a thread is pasting a file)
  */
 static void info_print(const char *str, int i) {
-    char st[100] = {0};
+    char st[300] = {0};
 
     wmove(info_win, i, 1);
     wclrtoeol(info_win);
@@ -650,13 +784,11 @@ static void info_print(const char *str, int i) {
     
     switch (i) {
     case INFO_LINE:
-        if (selected) {
+        if (selected.num) {
             strncpy(st, _(selected_mess), sizeof(st) - 1);
         }
-        if (thread_h) {
-            sprintf(st + strlen(st), "[%d/%d] %s", thread_h->num, num_of_jobs, _(thread_job_mesg[thread_h->type]));
-        }
-        mvwprintw(info_win, INFO_LINE, COLS - strlen(st), st);
+        jobs_status(st, sizeof(st));
+        mvwprintw(info_win, INFO_LINE, COLS - strlen(st), "%s", st);
         break;
     case ERR_LINE:
         if (sv.searching) {
@@ -664,42 +796,40 @@ static void info_print(const char *str, int i) {
         }
         break;
     }
-    wrefresh(info_win);
+    wnoutrefresh(info_win);
 }
 
 /*
  * if info_win is not NULL:
- * it needs to malloc (COLS - len) bytes (printable chars on the screen) 
- * or strlen(str) bytes (it depends upon which value is smaller).
- * we need malloc because window can be resized (ie: COLS is not a constant)
- * then writes on the pipe the address of the heap-allocated struct info_msg.
+ * copies at most (COLS - len) bytes of str (printable chars on the screen)
+ * to line's slot (replacing any message still pending there),
+ * then wakes up main_poll through info_fd,
+ * unless it has already been woken up and has not read the slots yet.
+ * No malloc is needed, whatever thread is printing, and no message is ever dropped
+ * but for an older one of the same line, that would have been overwritten anyway.
  */
 void print_info(const char *str, int line) {
     if (info_win) {
-        struct info_msg *info;
-        int len = 1 + strlen(info_win_str[line]);
+        struct info_slot *slot = &info_slots[line];
+        int len = COLS - 1 - strlen(info_win_str[line]), signal;
     
-        if (!(info = malloc(sizeof(struct info_msg)))) {
-            goto error;
+        if (len > INFO_MSG_LEN - 1) {
+            len = INFO_MSG_LEN - 1;
         }
-        info->msg = strndup(str, sizeof(char) * (COLS - len));
-        if (!info->msg) {
-            free(info);
-            goto error;
+        if (len < 0) {
+            len = 0;
         }
-        info->line = line;
-        ssize_t r = write(info_fd[1], &info, sizeof(struct info_msg *));
-        if (r <= 0) {
-            free(info->msg);
-            free(info);
-            WARN("a message could not be written.");
+        pthread_mutex_lock(&info_lock);
+        strncpy(slot->msg, str, len);
+        slot->msg[len] = '\0';
+        slot->dirty = 1;
+        signal = !info_signalled;
+        info_signalled = 1;
+        pthread_mutex_unlock(&info_lock);
+        if (signal) {
+            eventfd_write(info_fd, 1);
         }
     }
-    return;
-    
-error:
-    quit = MEM_ERR_QUIT;
-    ERROR("could not malloc.");
 }
 
 void print_and_warn(const char *err, int line) {
@@ -901,12 +1031,17 @@ static void fix_input_cursor_pos(void) {
 wint_t main_poll(WINDOW *win) {
     uint64_t t;
     wint_t c;
-    int ret = wget_wch(win, &c);
+    int ret;
+    
+    update_prefetch();
+    ret = wget_wch(win, &c);
     /*
      * if ret == ERR, it means we did not receive a getch event.
      * so it is useless to return.
      */
     while ((ret == ERR) && (!quit)) {
+        // every window updated since last poll is sent to terminal at once
+        doupdate();
         fix_input_cursor_pos(); // if we're currently asking a question, move cursor to its correct position on ASK_LINE
         /*
         * resize event returns -EPERM error with poll (-1)
@@ -942,6 +1077,22 @@ wint_t main_poll(WINDOW *win) {
                     /* we received a signal */
                         sig_handler(main_p[i].fd);
                         break;
+                    case LOADER_IX:
+                    /* a dir listing has been completed */
+                        loader_refresh(main_p[i].fd);
+                        break;
+                    case REFRESH_IX:
+                    /* time to draw pending updates */
+                        refresh_pending(main_p[i].fd);
+                        break;
+                    case PREFETCH_IX:
+                    /* cursor rested on a dir */
+                        prefetch_timer(main_p[i].fd);
+                        break;
+                    case JOBS_IX:
+                    /* a job started or ended */
+                        jobs_refresh(main_p[i].fd);
+                        break;
 #if ARCHIVE_VERSION_NUMBER >= 3002000
                     case ARCHIVE_IX:
                     /* archiver thread needs a pwd for a protected archive */
@@ -1003,60 +1154,421 @@ void timer_event(void) {
     wmove(info_win, SYSTEM_INFO_LINE, 1);
     wclrtoeol(info_win);
     timer_func();
-    wrefresh(info_win);
+    wnoutrefresh(info_win);
 }
 
 /*
- * Reads from info_pipe the address of the struct previously
- * allocated on heap by print_info function(),
- * and prints it to info_win.
- * Then free all the resources.
+ * Moves latest message of each dirty info line to pending_info,
+ * until next refresh pass prints them to info_win.
+ * info_signalled is reset with info_lock held: any message published afterwards
+ * writes info_fd again.
  */
 static void info_refresh(int fd) {
-    struct info_msg *info;
+    uint64_t u;
+    
+    eventfd_read(fd, &u);
+    pthread_mutex_lock(&info_lock);
+    info_signalled = 0;
+    for (int i = 0; i < INFO_HEIGHT; i++) {
+        if (info_slots[i].dirty) {
+            strcpy(pending_info[i], info_slots[i].msg);
+            pending_lines |= 1 << i;
+            info_slots[i].dirty = 0;
+        }
+    }
+    pthread_mutex_unlock(&info_lock);
+    if (pending_lines) {
+        schedule_refresh();
+    }
+}
+
+/*
+ * Redraws INFO_LINE (eg: to update jobs progress) with next screen refresh.
+ */
+void refresh_info_line(void) {
+    pending_lines |= 1 << INFO_LINE;
+    schedule_refresh();
+}
+
+/*
+ * Moves to tabs lists published by their dir_jobs.
+ * If tab was already showing a partial list, cursor is kept on the same file.
+ */
+static void loader_refresh(int fd) {
+    uint64_t u;
     
-    read(fd, &info, sizeof(struct info_msg *));
-    info_print(info->msg, info->line);
-    free(info->msg);
-    free(info);
+    eventfd_read(fd, &u);
+    prefetch_done();
+    for (int win = 0; win < cont; win++) {
+        if (ps[win].job) {
+            int listed = ps[win].mode <= fast_browse_;
+            int saved = 0;
+            
+            if (listed && !strlen(ps[win].old_file) && ps[win].job->taken == LOAD_PARTIAL) {
+                save_old_pos(win);
+                saved = 1;
+            }
+            int state = take_listing(win);
+            // a just stamped job has no list yet
+            if (state != -1 && state != LOAD_STAMPED) {
+                if (state == LOAD_DONE) {
+                    patch_entries(win, &ps[win].changed);
+                    free_list(&ps[win].changed);
+                }
+                if (listed) {
+                    ps[win].number_of_files = ps[win].nl.num;
+                    reset_win(win);
+                    restore_old_pos(win);
+                } else if (ps[win].mode == filter_) {
+                    mark_dirty(win, DIRTY_FILTER, 0);
+                }
+            } else if (saved) {
+                memset(ps[win].old_file, 0, strlen(ps[win].old_file));
+            }
+        }
+    }
 }
 
 /*
  * thanks: http://stackoverflow.com/questions/13351172/inotify-file-in-c
+ * Created/removed/moved files read with a single read are patched in the list
+ * all together (patch_entries); if they happen while dir is still being listed,
+ * they're patched once it is done.
+ * Only if events were lost (IN_Q_OVERFLOW), dir is listed again.
  */
 static void inotify_refresh(int win) {
-    size_t len, i = 0;
+    ssize_t len, i = 0;
     char buffer[BUF_LEN];
+    struct stat st;
+    struct file_list batch;
     
-    len = read(ps[win].inot.fd, buffer, BUF_LEN);
+    // watch may have been replaced since it was polled
+    if ((len = read(ps[win].inot.fd, buffer, BUF_LEN)) <= 0) {
+        return;
+    }
+    init_list(&batch, NULL);
     while (i < len) {
         struct inotify_event *event = (struct inotify_event *)&buffer[i];
-        /* ignore events for hidden files if ps[win].show_hidden is false */
-        if ((event->len) && ((event->name[0] != '.') || (ps[win].show_hidden))) {
+        if (event->mask & IN_Q_OVERFLOW) {
+            save_old_pos(win);
+            // some events were lost: list must not be cached
+            memset(&ps[win].stamp, 0, sizeof(ps[win].stamp));
+            tab_refresh(win);
+        } else if (event->len) {
+            /* hidden files events are needed too, as they're cached even if not shown */
             if ((event->mask & IN_CREATE) || (event->mask & IN_DELETE) || event->mask & IN_MOVE) {
-                save_old_pos(win);
-                tab_refresh(win);
+                struct file_list *l = ps[win].job ? &ps[win].changed : &batch;
+                
+                if (find_in_list(l, event->name) == -1) {
+                    add_to_list(l, event->name, DT_UNKNOWN);
+                }
             } else if (event->mask & IN_MODIFY || event->mask & IN_ATTRIB) {
-                if (ps[win].mywin.stat_active) {
-                    memset(ps[win].mywin.tot_size, 0, strlen(ps[win].mywin.tot_size));
-                    show_stat(ps[win].mywin.delta, dim - 2, win);
-                    print_border_and_title(win);
+                /* a file being written sends lots of these: it is stat'ed once per refresh pass */
+                struct file_list *l = ps[win].job ? &ps[win].changed : &ps[win].modified;
+                
+                if (find_in_list(l, event->name) == -1) {
+                    add_to_list(l, event->name, DT_UNKNOWN);
+                }
+                if (!ps[win].job) {
+                    schedule_refresh();
                 }
             }
         }
         i += EVENT_SIZE + event->len;
     }
+    // if dir is being listed again (events were lost), batch is not needed anymore
+    if (!ps[win].job) {
+        patch_entries(win, &batch);
+    }
+    free_list(&batch);
+    // every event read has been patched: list matches dir as it is now
+    // (unless list was not complete in the first place).
+    // If dir cannot be stat'ed in time, list must not be cached.
+    if (!ps[win].job && ps[win].stamp.ino) {
+        if (bounded_stat(ps[win].my_cwd, &st, ENTER_STAT_TIMEOUT) == 0) {
+            make_stamp(&st, &ps[win].stamp);
+        } else {
+            memset(&ps[win].stamp, 0, sizeof(ps[win].stamp));
+        }
+    }
+}
+
+/*
+ * Brings entries of win's list named after names up to date with their files,
+ * in a single merge pass (merge_changes): old entries are removed, and files
+ * that still exist are inserted again at their sorted position.
+ * Cursor is kept on the same file (and in the same row, if changes are above it),
+ * and only changed rows are redrawn.
+ */
+static void patch_entries(int win, struct file_list *names) {
+    struct file_list *l = &ps[win].nl;
+    char cursor_file[PATH_MAX + 1] = {0}, path[PATH_MAX + 1];
+    int track[2] = {ps[win].curr_pos, ps[win].mywin.delta};
+    int first, last, cursor_changed = 0;
+    
+    if (!ALL_ENTRIES(names)) {
+        return;
+    }
+    if (ps[win].curr_pos < l->num) {
+        strncpy(cursor_file, list_name(l, ps[win].curr_pos), PATH_MAX);
+        cursor_changed = find_in_list(names, cursor_file) != -1;
+    }
+    first = merge_changes(l, names, ps[win].show_hidden, sorting_func[ps[win].sorting_index], track, 2, &last);
+    if (selected.num) {
+        for (int i = 0; i < ALL_ENTRIES(names); i++) {
+            int k = find_in_list(l, list_name(names, i));
+            
+            if (k != -1) {
+                l->entries[k].selected = is_selected(list_fullpath(l, k, path));
+            }
+        }
+    }
+    if (first != -1 && ps[win].mode == filter_) {
+        mark_dirty(win, DIRTY_FILTER, 0);
+    }
+    // only hidden entries changed, or tab is showing a special mode list
+    if (first == -1 || ps[win].mode > fast_browse_) {
+        return;
+    }
+    // cursor follows its file, if it was inserted again
+    if (cursor_changed) {
+        int k = find_in_list(l, cursor_file);
+        
+        if (k != -1 && k < l->num) {
+            track[0] = k;
+        }
+    }
+    if (track[0] >= l->num) {
+        track[0] = l->num - 1;
+    }
+    if (track[0] < 0) {
+        track[0] = 0;
+    }
+    // remove old cursor, if it is going to be drawn on another row
+    if (track[0] - track[1] != ps[win].curr_pos - ps[win].mywin.delta) {
+        mvwprintw(ps[win].mywin.fm, ps[win].curr_pos - ps[win].mywin.delta + 1, 1, "  ");
+    }
+    ps[win].curr_pos = track[0];
+    ps[win].mywin.delta = track[1];
+    ps[win].number_of_files = l->num;
+    if (last < ps[win].mywin.delta || first >= ps[win].mywin.delta + dim - 2) {
+        // no visible row changed: only total size could need an update
+        if (ps[win].mywin.stat_active) {
+            mark_dirty(win, DIRTY_TOTAL, 0);
+        }
+    } else {
+        mark_dirty(win, DIRTY_ROWS, first);
+    }
+}
+
+/*
+ * Stats name file again, after it was modified.
+ * If its position in the list did not change, total size is adjusted
+ * by its size delta, and only its row is redrawn (if visible).
+ * Otherwise (or if it is not in list) it is added to moved, to be patched (patch_entries).
+ */
+static void restat_entry(int win, const char *name, struct file_list *moved) {
+    struct file_list *l = &ps[win].nl;
+    int i = find_in_list(l, name);
+    int (*sort_func)(const void *, const void *, void *) = sorting_func[ps[win].sorting_index];
+    struct file_entry *e;
+    off_t old_size;
+    
+    if (i == -1) {
+        add_to_list(moved, name, DT_UNKNOWN);
+        return;
+    }
+    e = &l->entries[i];
+    old_size = e->size;
+    e->stat_state = STAT_MISSING;
+    if (list_stat(l, i)->stat_state != STAT_CACHED
+        || (i < l->num && i > 0 && sort_func(&l->entries[i - 1], e, l) > 0)
+        || (i < l->num - 1 && sort_func(e, &l->entries[i + 1], l) > 0)) {
+        add_to_list(moved, name, DT_UNKNOWN);
+        return;
+    }
+    if (i >= l->num || ps[win].mode > fast_browse_ || !ps[win].mywin.stat_active) {
+        // filtered list holds a copy of its stats
+        if (i < l->num && ps[win].mode == filter_ && ps[win].mywin.stat_active) {
+            mark_dirty(win, DIRTY_FILTER, 0);
+        }
+        return;
+    }
+    if (strlen(ps[win].mywin.tot_size)) {
+        char str[30];
+        
+        ps[win].mywin.tot_bytes += e->size - old_size;
+        change_unit(ps[win].mywin.tot_bytes, str);
+        sprintf(ps[win].mywin.tot_size, "Total size: %s", str);
+    }
+    if (i >= ps[win].mywin.delta && i < ps[win].mywin.delta + dim - 2) {
+        list_everything(win, i, 1);
+    } else {
+        print_border_and_title(win);
+    }
+}
+
+/*
+ * Redraws win's rows from idx to the bottom of the window
+ * (clearing rows after the last file).
+ * If cursor went out of the window, window is scrolled to show it.
+ */
+static void redraw_from(int win, int idx) {
+    WINDOW *fm = ps[win].mywin.fm;
+    
+    if (ps[win].curr_pos < ps[win].mywin.delta || ps[win].curr_pos >= ps[win].mywin.delta + dim - 2) {
+        ps[win].mywin.delta = ps[win].curr_pos - (dim - 3) > 0 ? ps[win].curr_pos - (dim - 3) : 0;
+        idx = ps[win].mywin.delta;
+    } else if (idx < ps[win].mywin.delta) {
+        idx = ps[win].mywin.delta;
+    }
+    for (int i = ps[win].number_of_files; i < ps[win].mywin.delta + dim - 2; i++) {
+        wmove(fm, i + 1 - ps[win].mywin.delta, 1);
+        wclrtoeol(fm);
+    }
+    invalidate_rows(win, ps[win].number_of_files - ps[win].mywin.delta);
+    if (ps[win].mywin.stat_active) {
+        memset(ps[win].mywin.tot_size, 0, strlen(ps[win].mywin.tot_size));
+    }
+    list_everything(win, idx, ps[win].mywin.delta + dim - 2 - idx);
+}
+
+/*
+ * Records that win needs to be updated (from row, for DIRTY_ROWS),
+ * and schedules a refresh pass.
+ */
+static void mark_dirty(int win, int flag, int row) {
+    if (flag == DIRTY_ROWS && (!(ps[win].mywin.dirty & DIRTY_ROWS) || row < ps[win].mywin.dirty_row)) {
+        ps[win].mywin.dirty_row = row;
+    }
+    ps[win].mywin.dirty |= flag;
+    schedule_refresh();
+}
+
+/*
+ * Arms refresh_fd, if not already armed: it fires after config.refresh_delay ms,
+ * but not before MIN_FRAME_INTERVAL ms passed since last refresh pass.
+ * This way a storm of updates (eg: while a big dir is being copied inside a watched one)
+ * is drawn at most once every MIN_FRAME_INTERVAL ms.
+ */
+static void schedule_refresh(void) {
+    struct itimerspec timer = {{0}};
+    struct timespec now;
+    long delay, elapsed;
+    
+    if (refresh_armed) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - last_refresh.tv_sec) * 1000 + (now.tv_nsec - last_refresh.tv_nsec) / 1000000;
+    delay = config.refresh_delay;
+    if (MIN_FRAME_INTERVAL - elapsed > delay) {
+        delay = MIN_FRAME_INTERVAL - elapsed;
+    }
+    if (delay > 0) {
+        timer.it_value.tv_sec = delay / 1000;
+        timer.it_value.tv_nsec = (delay % 1000) * 1000000;
+        if (timerfd_settime(refresh_fd, 0, &timer, NULL) == 0) {
+            refresh_armed = 1;
+            return;
+        }
+    }
+    // no delay needed (or timer not available): refresh right now
+    refresh_pending(-1);
+}
+
+/*
+ * Refresh pass: prints pending info messages,
+ * and redraws tabs that received any update since last pass.
+ * fd is refresh_fd, or -1 if called directly.
+ */
+static void refresh_pending(int fd) {
+    uint64_t t;
+    
+    if (fd != -1) {
+        read(fd, &t, sizeof(t));
+    }
+    // updates marked while stating modified files are drawn by this same pass
+    refresh_armed = 1;
+    for (int win = 0; win < cont; win++) {
+        struct file_list moved;
+        
+        init_list(&moved, NULL);
+        for (int i = 0; i < ps[win].modified.num; i++) {
+            restat_entry(win, list_name(&ps[win].modified, i), &moved);
+        }
+        free_list(&ps[win].modified);
+        patch_entries(win, &moved);
+        free_list(&moved);
+    }
+    refresh_armed = 0;
+    clock_gettime(CLOCK_MONOTONIC, &last_refresh);
+    for (int i = 0; i < INFO_HEIGHT; i++) {
+        if (pending_lines & (1 << i)) {
+            info_print(pending_info[i], i);
+        }
+    }
+    pending_lines = 0;
+    for (int win = 0; win < cont; win++) {
+        int dirty = ps[win].mywin.dirty;
+        
+        ps[win].mywin.dirty = 0;
+        if ((dirty & DIRTY_FILTER) && ps[win].mode == filter_) {
+            update_filter(win);
+        }
+        if (!dirty || ps[win].mode > fast_browse_) {
+            continue;
+        }
+        if (dirty & DIRTY_ROWS) {
+            redraw_from(win, ps[win].mywin.dirty_row);
+        } else if (ps[win].mywin.stat_active) {
+            memset(ps[win].mywin.tot_size, 0, strlen(ps[win].mywin.tot_size));
+            update_total_size(win);
+            print_border_and_title(win);
+        }
+    }
 }
 
 /*
  * Refreshes win UI if win is not in special_mode
  * (searching, bookmarks or device mode)
  */
-void tab_refresh(int win) {
-     if (ps[win].mode <= fast_browse_) {
-        generate_list(win);
-        if (strlen(ps[win].old_file)) {
-            move_cursor_to_file(0, ps[win].old_file, win);
+int tab_refresh(int win) {
+    int ret = 0;
+    
+    if (ps[win].mode <= fast_browse_) {
+        ret = generate_list(win);
+        restore_old_pos(win);
+    }
+    return ret;
+}
+
+/*
+ * Re-filters (dotfiles) and re-sorts win's list in memory,
+ * without rescanning its dir, then reprints it.
+ * If dir is still being listed, listing is restarted instead.
+ */
+void tab_resort(int win) {
+    if (ps[win].mode <= fast_browse_) {
+        if (ps[win].job) {
+            tab_refresh(win);
+        } else if (filter_list(&ps[win].nl, ps[win].show_hidden) == 0 &&
+                   sort_list(&ps[win].nl, ps[win].sorting_index, NULL) == 0) {
+            ps[win].number_of_files = ps[win].nl.num;
+            reset_win(win);
+            restore_old_pos(win);
+        }
+    }
+}
+
+/*
+ * Moves cursor to old_file.
+ * If it is not in the list while its dir_job is still running,
+ * it is kept, to be looked for in next list.
+ */
+static void restore_old_pos(int win) {
+    if (strlen(ps[win].old_file)) {
+        if (move_cursor_to_file(0, ps[win].old_file, win) || !ps[win].job) {
             memset(ps[win].old_file, 0, strlen(ps[win].old_file));
         }
     }
@@ -1065,7 +1577,7 @@ void tab_refresh(int win) {
 /*
  * Used to refresh special_mode windows.
  */
-void update_special_mode(int num,  char (*str)[PATH_MAX + 1], int mode) {
+void update_special_mode(int num, struct file_list *str, int mode) {
     for (int win = 0; win < cont; win++) {
         if (ps[win].mode == mode) {
             if (num == 0) {
@@ -1092,10 +1604,31 @@ void update_special_mode(int num,  char (*str)[PATH_MAX + 1], int mode) {
     }
 }
 
+/*
+ * Used to refresh special_mode windows whose entries changed in place (eg: jobs):
+ * every row is redrawn, keeping cursor on the same index where possible.
+ */
+void redraw_special_mode(int num, struct file_list *str, int mode) {
+    for (int win = 0; win < cont; win++) {
+        if (ps[win].mode == mode) {
+            if (num == 0) {
+                leave_special_mode(ps[win].my_cwd, win);
+            } else {
+                ps[win].number_of_files = num;
+                str_ptr[win] = str;
+                if (ps[win].curr_pos >= num) {
+                    ps[win].curr_pos = num - 1;
+                }
+                redraw_from(win, 0);
+            }
+        }
+    }
+}
+
 /*
  * Used when switching to special_mode.
  */
-void show_special_tab(int num, char (*str)[PATH_MAX + 1], const char *title, int mode) {
+void show_special_tab(int num, struct file_list *str, const char *title, int mode) {
     ps[active].mode = mode;
     ps[active].number_of_files = num;
     if (mode != fast_browse_) {
@@ -1106,7 +1639,10 @@ void show_special_tab(int num, char (*str)[PATH_MAX + 1], const char *title, int
         reset_win(active);
         // rm inotify watch for this special mode tab as it is not needed while in special mode.
         // when leaving, change_dir will re-add this.
-        inotify_rm_watch(ps[active].inot.fd, ps[active].inot.wd);
+        // Filter mode shows current dir: its list is still kept up to date.
+        if (mode != filter_) {
+            drop_tab_watch(active);
+        }
     } else {
         // we're entering fast browse mode. We don't need to clear anything.
         // if we're entering special mode, we were in normal mode
@@ -1121,12 +1657,26 @@ void show_special_tab(int num, char (*str)[PATH_MAX + 1], const char *title, int
 
 /*
  * used when leaving special mode.
+ * Leaving filter mode, cursor is kept on the same file.
  */
 void leave_special_mode(const char *str,int win) {
     int old_mode = ps[win].mode;
     
     ps[win].mode = normal;
-    if (old_mode != fast_browse_) {
+    if (old_mode == filter_) {
+        int i = find_in_list(&ps[win].nl, list_name(&ps[win].filtered, ps[win].curr_pos));
+        
+        free_list(&ps[win].filtered);
+        memset(ps[win].filter_str, 0, sizeof(ps[win].filter_str));
+        memset(ps[win].old_file, 0, strlen(ps[win].old_file));
+        str_ptr[win] = &ps[win].nl;
+        ps[win].number_of_files = ps[win].nl.num;
+        strncpy(ps[win].title, ps[win].my_cwd, PATH_MAX);
+        reset_win(win);
+        if (i != -1 && i < ps[win].nl.num) {
+            move_cursor(win, i);
+        }
+    } else if (old_mode != fast_browse_) {
         change_dir(str, win);
     }
     if (win == active) {
@@ -1191,43 +1741,37 @@ static void resize_fm_win(void) {
 }
 
 void change_sort(void) {
-    ps[active].sorting_index = (ps[active].sorting_index + 1) % NUM(sorting_func);
+    ps[active].sorting_index = (ps[active].sorting_index + 1) % NUM_SORTS;
     print_info(_(sorting_str[ps[active].sorting_index]), INFO_LINE);
     save_old_pos(active);
-    tab_refresh(active);
+    tab_resort(active);
 }
 
 /*
- * Called in manage_space_press() (fm_functions.c)
- * It checks for each fm win, if they're on the same cwd, then checks
- * if the file to be highlighted is visible inside "win" -> useful only if win is not the active one.
- * Then prints c char before current filename and refreshes win.
+ * Redraws selection mark of win's line (or of every visible line, if line == -1),
+ * from its entry's selected flag.
  */
-void highlight_selected(const char *str, const char c, int win) {
+void highlight_selected(int win, int line) {
     if (ps[win].mode <= fast_browse_) {
-        int line = is_present(str, ps[win].nl, ps[win].number_of_files, -1, 0);
-        if (line != -1 && (line - ps[win].mywin.delta >= 0) && (line - ps[win].mywin.delta < dim - 2)) {
-            wattron(ps[win].mywin.fm, A_BOLD);
-            mvwprintw(ps[win].mywin.fm, 1 + line - ps[win].mywin.delta, SEL_COL, "%c", c);
-            wattroff(ps[win].mywin.fm, A_BOLD);
-            wrefresh(ps[win].mywin.fm);
+        int start = ps[win].mywin.delta, end = ps[win].mywin.delta + dim - 2;
+        
+        if (line != -1) {
+            start = line > start ? line : start;
+            end = line + 1 < end ? line + 1 : end;
         }
+        for (int i = start; i < end && i < ps[win].number_of_files; i++) {
+            draw_row(win, i);
+        }
+        wnoutrefresh(ps[win].mywin.fm);
     }
 }
 
-static void check_selected(const char *str, int win, int line) {
-    int i = is_present(str, selected, num_selected, -1, 0);
-    if (i != -1) {
-        mvwprintw(ps[win].mywin.fm, 1 + line - ps[win].mywin.delta, SEL_COL, "*");
-    }
-}
-
+/*
+ * Called once selected flags were cleared: removes every visible selection mark.
+ */
 void erase_selected_highlight(void) {
     for (int j = 0; j < cont; j++) {
-        for (int i = 0; (i < dim - 2) && (i < ps[j].number_of_files); i++) {
-            mvwprintw(ps[j].mywin.fm, 1 + i, SEL_COL, " ");
-        }
-        wrefresh(ps[j].mywin.fm);
+        highlight_selected(j, -1);
     }
 }
 
@@ -1339,16 +1883,20 @@ static int check_sysinfo_where(int where, int len) {
 }
 
 void trigger_fullname_win(void) {
-    int len = strlen(str_ptr[active][ps[active].curr_pos]);
+    char path[PATH_MAX + 1];
+    int len = strlen(list_fullpath(str_ptr[active], ps[active].curr_pos, path));
     fullname_win_height = len / COLS + 1;
     trigger_show_additional_win(fullname_win_height, &fullname_win, fullname_print);
 }
 
 static void fullname_print(void) {
+    char path[PATH_MAX + 1];
+    
+    list_fullpath(str_ptr[active], ps[active].curr_pos, path);
     wattron(fullname_win, A_BOLD);
-    colored_folders(fullname_win, str_ptr[active][ps[active].curr_pos]);
-    mvwprintw(fullname_win, 0, 0, str_ptr[active][ps[active].curr_pos]);
-    wattroff(fullname_win, COLOR_PAIR);
+    attr_t attr = colored_folders(fullname_win, path, list_stat(str_ptr[active], ps[active].curr_pos));
+    mvwprintw(fullname_win, 0, 0, path);
+    wattroff(fullname_win, attr);
 }
 
 static void update_fullname_win(void) {
@@ -1,85 +1,25 @@
 #include "../inc/utils.h"
 
-void *remove_from_list(int *num, char (*str)[PATH_MAX + 1], int i) {
-    memmove(&str[i], &str[i + 1], ((*num) - 1 - i) * (PATH_MAX + 1));
-    return safe_realloc(--(*num), str);
-}
-
-void *safe_realloc(const size_t size, char (*str)[PATH_MAX + 1]) {
-    if (!(str = realloc(str, (PATH_MAX + 1) * size)) && size) {
-        quit = MEM_ERR_QUIT;
-        ERROR("could not realloc. Leaving.");
-    }
-    return str;
-}
+static void *stat_thread(void *x);
 
 /*
- * Check if filename has "." in it (otherwise surely it has not extension)
- * Then for each extension in *ext[], check if last strlen(ext[i]) chars of filename are 
- * equals to ext[i].
+ * A stat run by its own thread for bounded_stat:
+ * whoever (thread or caller) sees the other one gone frees it.
  */
-int is_ext(const char *filename, const char *ext[], int size) {
-    int len = strlen(filename);
-    
-    if (strrchr(filename, '.')) {
-        int i = 0;
-        
-        while (i < size) {
-            if (!strcmp(filename + len - strlen(ext[i]), ext[i])) {
-                return 1;
-            }
-            i++;
-        }
-    }
-    return 0;
-}
-
-int get_mimetype(const char *path, const char *test) {
-    int ret = 0;
-    const char *mimetype;
-    magic_t magic;
-    
-    if ((magic = magic_open(MAGIC_MIME_TYPE)) == NULL) {
-        ERROR("An error occurred while loading libmagic database.");
-        return ret;
-    }
-    if (magic_load(magic, NULL) == -1) {
-        ERROR("An error occurred while loading libmagic database.");
-        goto end;
-    }
-    if ((mimetype = magic_file(magic, path)) == NULL) {
-        ERROR("An error occurred while loading libmagic database.");
-        goto end;
-    }
-    if (strstr(mimetype, test)) {
-        ret = 1;
-    }
-    
-end:
-    magic_close(magic);
-    return ret;
-}
+struct bounded_stat {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char path[PATH_MAX + 1];
+    struct stat st;
+    int ret, err, done, abandoned;
+};
 
 int move_cursor_to_file(int start_idx, const char *filename, int win) {
-    int len;
-    char fullpath[PATH_MAX + 1] = {0};
+    int i = find_prefix(&ps[win].nl, filename, start_idx);
     
-    snprintf(fullpath, PATH_MAX, "%s/%s", ps[win].my_cwd, filename);
-    len = strlen(fullpath);
-    int i = is_present(fullpath, ps[win].nl, ps[win].number_of_files, len, start_idx);
     if (i != -1) {
         if (i != ps[win].curr_pos) {
-            void (*f)(int, int);
-            int delta;
-            
-            if (i < ps[win].curr_pos) {
-                f = scroll_up;
-                delta = ps[win].curr_pos - i;
-            } else {
-                f = scroll_down;
-                delta = i - ps[win].curr_pos;
-            }
-            f(win, delta);
+            move_cursor(win, i);
         }
         return 1;
     }
@@ -87,30 +27,11 @@ int move_cursor_to_file(int start_idx, const char *filename, int win) {
 }
 
 void save_old_pos(int win) {
-    char *str;
-    
-    str = strrchr(ps[win].nl[ps[win].curr_pos], '/') + 1;
-    strncpy(ps[win].old_file, str, NAME_MAX);
-}
-
-int is_present(const char *name, char (*str)[PATH_MAX + 1], int num, int len, int start_idx) {
-    int cmp;
-    
-    for (int i = start_idx; i < num; i++) {
-        if (len != -1) {
-            cmp = strncmp(str[i], name, len);
-        } else {
-            cmp = strcmp(str[i], name);
-        }
-        if (!cmp) {
-            return i;
-        }
-    }
-    return -1;
+    strncpy(ps[win].old_file, list_name(&ps[win].nl, ps[win].curr_pos), NAME_MAX);
 }
 
 /*
- * Helper function used in show_stat: received a size,
+ * Helper function used to print stats: received a size,
  * it changes the unit from Kb to Mb to Gb if size > 1024(previous unit)
  */
 void change_unit(float size, char *str) {
@@ -127,13 +48,137 @@ void change_unit(float size, char *str) {
 void leave_mode_helper(struct stat s) {
     char str[PATH_MAX + 1] = {0};
     
-    strncpy(str, str_ptr[active][ps[active].curr_pos], PATH_MAX);
+    list_fullpath(str_ptr[active], ps[active].curr_pos, str);
     if (!S_ISDIR(s.st_mode)) {
-        strncpy(ps[active].old_file, strrchr(str_ptr[active][ps[active].curr_pos], '/') + 1, NAME_MAX);
-        int len = strlen(str_ptr[active][ps[active].curr_pos]) - strlen(ps[active].old_file);
+        strncpy(ps[active].old_file, strrchr(str, '/') + 1, NAME_MAX);
+        int len = strlen(str) - strlen(ps[active].old_file);
         str[len] = '\0';
     } else {
         memset(ps[active].old_file, 0, strlen(ps[active].old_file));
     }
     leave_special_mode(str, active);
 }
+
+/*
+ * Writes to path the absolute path of str, relative to cwd if it is not absolute itself.
+ * Path is computed lexically (".." drops last component, as shells do), so no syscall is needed:
+ * main thread must never block on a hung mount.
+ * Returns -1 if path would be longer than PATH_MAX.
+ */
+int make_path(const char *cwd, const char *str, char *path) {
+    char tmp[2 * PATH_MAX + 2], *save;
+    size_t len = 0;
+    
+    if (str[0] == '/') {
+        strncpy(tmp, str, sizeof(tmp) - 1);
+    } else {
+        snprintf(tmp, sizeof(tmp), "%s/%s", cwd, str);
+    }
+    tmp[sizeof(tmp) - 1] = '\0';
+    for (char *comp = strtok_r(tmp, "/", &save); comp; comp = strtok_r(NULL, "/", &save)) {
+        if (!strcmp(comp, "..")) {
+            while (len && path[--len] != '/');
+        } else if (strcmp(comp, ".")) {
+            size_t comp_len = strlen(comp);
+            
+            if (len + comp_len + 1 > PATH_MAX) {
+                return -1;
+            }
+            path[len++] = '/';
+            memcpy(path + len, comp, comp_len);
+            len += comp_len;
+        }
+    }
+    if (!len) {
+        path[len++] = '/';
+    }
+    path[len] = '\0';
+    return 0;
+}
+
+/*
+ * Sets ts to timeout ms from now (CLOCK_MONOTONIC).
+ */
+void make_deadline(struct timespec *ts, int timeout) {
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += timeout / 1000;
+    ts->tv_nsec += (timeout % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/*
+ * stat for main thread: it is run by another thread, waited for at most timeout ms.
+ * If it takes longer (eg: a hung mount), it is abandoned: -1 is returned, with errno set to ETIMEDOUT.
+ */
+int bounded_stat(const char *path, struct stat *st, int timeout) {
+    struct bounded_stat *s = calloc(1, sizeof(struct bounded_stat));
+    struct timespec ts;
+    pthread_condattr_t attr;
+    pthread_attr_t th_attr;
+    pthread_t th;
+    int ret = -1, err = ETIMEDOUT, done;
+    
+    if (!s) {
+        quit = MEM_ERR_QUIT;
+        ERROR("could not malloc.");
+        errno = ENOMEM;
+        return -1;
+    }
+    strncpy(s->path, path, PATH_MAX);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_attr_init(&th_attr);
+    pthread_attr_setdetachstate(&th_attr, PTHREAD_CREATE_DETACHED);
+    make_deadline(&ts, timeout);
+    if (pthread_create(&th, &th_attr, stat_thread, s)) {
+        // no way to bound it: better not to stat at all
+        s->done = 1;
+        s->err = EAGAIN;
+    }
+    pthread_attr_destroy(&th_attr);
+    pthread_mutex_lock(&s->lock);
+    while (!s->done && pthread_cond_timedwait(&s->cond, &s->lock, &ts) != ETIMEDOUT);
+    if ((done = s->done)) {
+        ret = s->ret;
+        err = s->err;
+        *st = s->st;
+    } else {
+        s->abandoned = 1;
+    }
+    pthread_mutex_unlock(&s->lock);
+    // an abandoned stat is freed by its thread
+    if (done) {
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->cond);
+        free(s);
+    }
+    errno = err;
+    return ret;
+}
+
+static void *stat_thread(void *x) {
+    struct bounded_stat *s = (struct bounded_stat *)x;
+    struct stat st;
+    int ret = stat(s->path, &st), err = errno, abandoned;
+    
+    pthread_mutex_lock(&s->lock);
+    s->st = st;
+    s->ret = ret;
+    s->err = err;
+    s->done = 1;
+    abandoned = s->abandoned;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    if (abandoned) {
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->cond);
+        free(s);
+    }
+    return NULL;
+}
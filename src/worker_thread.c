@@ -1,162 +1,778 @@
 #include "../inc/worker_thread.h"
 
-static thread_job_list *add_job(thread_job_list *h, int type, int (*f)(void));
-static void free_running_h(void);
-static int init_thread_helper(void);
+static thread_job_list *new_job(int type, int (*f)(void));
+static void add_job(thread_job_list *job);
+static void remove_job(thread_job_list *job);
+static int init_thread_helper(thread_job_list *job);
+static void add_dev(thread_job_list *job, const char *path);
+static int can_run(const thread_job_list *job);
+static thread_job_list *next_job(void);
+static void end_job(thread_job_list *job, int ret);
+static const char *copy_report(const char *str, const int *copied_by, char *mesg, size_t size);
 static void *execute_thread(void *x);
+static void scan_job(thread_job_list *job);
+static int scan_entry(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf);
+static void notify_jobs(void);
+static void sample_jobs(void);
+static void format_progress(const thread_job_list *job, char *str, size_t size);
+static thread_job_list **find_job(int num);
+static int viewed_job(void);
+static void update_jobs_view(void);
+
+__thread struct thread_list *current_job;
 
 static thread_job_list *current_th; // current_th: ptr to latest elem in thread_l list
-static struct thread_mesg thread_m;
 static pthread_mutex_t job_lck;
+static pthread_cond_t job_cond;
+// num_workers: worker threads alive; idle_workers: those waiting for a runnable job
+static int num_workers, idle_workers;
+// jobs mode list: an entry for each job, starting with "[num]"
+static struct file_list jobs_view;
 #ifdef SYSTEMD_PRESENT
 static int inhibit_fd;
 #endif
 
 /*
- * Initializes mutex
+ * Initializes mutex and condition variable
  */
 void init_job_queue(void) {
     pthread_mutex_init(&job_lck, NULL);
+    pthread_cond_init(&job_cond, NULL);
 }
 
 /*
- * Destroys mutex
+ * Destroys mutex and condition variable
  */
 void destroy_job_queue(void) {
+    pthread_cond_destroy(&job_cond);
     pthread_mutex_destroy(&job_lck);
 }
 
 /*
- * Creates a new job object for the worker_thread appending it to the end of job's queue.
+ * Creates a new job object for the worker threads.
  */
-static thread_job_list *add_job(thread_job_list *h, int type, int (*f)(void)) {
-    pthread_mutex_lock(&job_lck);
-    if (h) {
-        current_th->next = add_job(current_th->next, type, f);
+static thread_job_list *new_job(int type, int (*f)(void)) {
+    thread_job_list *job;
+
+    if (!(job = calloc(1, sizeof(struct thread_list)))) {
+        quit = MEM_ERR_QUIT;
+        ERROR("could not malloc. Leaving.");
+        return NULL;
+    }
+    init_list(&job->selected_files, NULL);
+    job->f = f;
+    strncpy(job->full_path, ps[active].my_cwd, PATH_MAX);
+    job->type = type;
+    return job;
+}
+
+/*
+ * Appends job to the end of job's queue. Called with job_lck held.
+ */
+static void add_job(thread_job_list *job) {
+    if (thread_h) {
+        current_th->next = job;
     } else {
-        if (!(h = malloc(sizeof(struct thread_list)))) {
-            quit = MEM_ERR_QUIT;
-            ERROR("could not malloc. Leaving.");
-            return NULL;
-        }
-        num_of_jobs++;
-        h->selected_files = NULL;
-        h->next = NULL;
-        h->f = f;
-        strncpy(h->full_path, ps[active].my_cwd, PATH_MAX);
-        h->num_selected = num_selected;
-        h->type = type;
-        h->num = num_of_jobs;
-        current_th = h;
+        thread_h = job;
     }
-    pthread_mutex_unlock(&job_lck);
-    return h;
+    current_th = job;
+    job->num = ++num_of_jobs;
 }
 
 /*
- * Deletes current job object and updates job queue.
+ * Deletes job object and updates job queue. Called with job_lck held.
  */
-static void free_running_h(void) {
-    pthread_mutex_lock(&job_lck);
-    thread_job_list *tmp = thread_h;
+static void remove_job(thread_job_list *job) {
+    thread_job_list **tmp = &thread_h, *prev = NULL;
 
-    thread_h = thread_h->next;
-    if (tmp->selected_files)
-        free(tmp->selected_files);
-    free(tmp);
-    tmp = NULL;
-    pthread_mutex_unlock(&job_lck);
+    while (*tmp != job) {
+        prev = *tmp;
+        tmp = &(*tmp)->next;
+    }
+    *tmp = job->next;
+    if (current_th == job) {
+        current_th = prev;
+    }
+    free_list(&job->selected_files);
+    free(job);
 }
 
+/*
+ * Queues the job once it is ready, then wakes up an idle worker,
+ * or starts a new one if every worker is busy.
+ */
 void init_thread(int type, int (* const f)(void)) {
-    if (!(thread_h = add_job(thread_h, type, f))) {
+    thread_job_list *job;
+    int runnable;
+
+    if (!(job = new_job(type, f))) {
         return;
     }
-    if (init_thread_helper() == -1) {
+    if (init_thread_helper(job) == -1) {
+        free(job);
         return;
     }
-    if (num_of_jobs > 1) {
+    pthread_mutex_lock(&job_lck);
+    runnable = can_run(job);
+    add_job(job);
+#ifdef SYSTEMD_PRESENT
+    if (!num_workers && config.inhibit) {
+        inhibit_fd = inhibit_suspend("Job in process...");
+    }
+#endif
+    if (idle_workers) {
+        pthread_cond_broadcast(&job_cond);
+    } else if (num_workers < MAX_WORKERS) {
+        pthread_t th;
+
+        if (pthread_create(&th, NULL, execute_thread, NULL) == 0) {
+            num_workers++;
+        } else {
+            ERROR("could not start a worker thread.");
+        }
+    }
+    pthread_mutex_unlock(&job_lck);
+    if (!runnable) {
         print_info(_(thread_running), INFO_LINE);
         INFO("job added to job's queue.");
     } else {
-#ifdef SYSTEMD_PRESENT
-        if (config.inhibit) {
-            inhibit_fd = inhibit_suspend("Job in process...");
-        }
-#endif
         // update info_line with newly added job
         print_info("", INFO_LINE);
         INFO("starting a job.");
-        pthread_create(&worker_th, NULL, execute_thread, NULL);
     }
 }
 
 /*
- * Fixes some needed current_th variables.
+ * Fixes some needed job variables, then stores devices the job will touch:
+ * the ones of its selected files, and the one of current dir, where it writes
+ * (removals do not write, and archives are extracted next to them).
  */
-static int init_thread_helper(void) {
-    if (current_th->type == ARCHIVER_TH) {
-        char name[NAME_MAX + 1] = {0};
+static int init_thread_helper(thread_job_list *job) {
+    if (job->type == ARCHIVER_TH) {
+        char name[NAME_MAX + 1] = {0}, path[PATH_MAX + 1];
         int num = 1, len;;
-        
+
         ask_user(_(archiving_mesg), name, NAME_MAX);
         if (name[0] == 27) {
-            free(current_th);
-            current_th = NULL;
             return -1;
         }
         if (!strlen(name)) {
-            strncpy(name, strrchr(selected[0], '/') + 1, NAME_MAX);
+            strncpy(name, strrchr(list_name(&selected, 0), '/') + 1, NAME_MAX);
         }
         /* avoid overwriting a compressed file in path if it has the same name of the archive being created there */
         len = strlen(name);
         strcat(name, ".tgz");
-        while (access(name, F_OK) == 0) {
+        // process cwd is not current dir: check full path
+        while (snprintf(path, PATH_MAX + 1, "%s/%s", job->full_path, name) <= PATH_MAX && access(path, F_OK) == 0) {
             sprintf(name + len, "%d.tgz", num);
             num++;
         }
-        len = strlen(current_th->full_path);
-        snprintf(current_th->full_path + len, PATH_MAX - 1, "/%s", name);
+        add_dev(job, job->full_path);
+        len = strlen(job->full_path);
+        snprintf(job->full_path + len, PATH_MAX - 1, "/%s", name);
+    } else if (job->type != RM_TH && job->type != EXTRACTOR_TH) {
+        add_dev(job, job->full_path);
     }
-    current_th->selected_files = selected;
-    selected = NULL;
-    num_selected = 0;
+    // job takes ownership of selected files list
+    job->selected_files = selected;
+    init_list(&selected, NULL);
+    reset_selection();
     erase_selected_highlight();
+    for (int i = 0; i < job->selected_files.num && job->num_devs <= MAX_JOB_DEVS; i++) {
+        add_dev(job, list_name(&job->selected_files, i));
+    }
     return 0;
 }
 
+static void add_dev(thread_job_list *job, const char *path) {
+    struct stat sb;
+
+    if (lstat(path, &sb) == -1) {
+        return;
+    }
+    for (int i = 0; i < job->num_devs && i < MAX_JOB_DEVS; i++) {
+        if (job->devs[i] == sb.st_dev) {
+            return;
+        }
+    }
+    if (job->num_devs < MAX_JOB_DEVS) {
+        job->devs[job->num_devs] = sb.st_dev;
+    }
+    job->num_devs++;
+}
+
 /*
- * While job's queue isn't empty, exec job's queue head function, frees its resources, updates UI and notifies user.
- * Finally, call itself recursively.
- * When job's queue is empty, reset some vars and returns.
+ * A job can run if, for each of its devices, less than config.jobs_per_device
+ * running jobs are touching it. Jobs whose devices are unknown
+ * (none could be stat'ed, or they did not fit in devs) run alone.
+ * Called with job_lck held.
  */
-static void *execute_thread(void *x) {
-    if (thread_h) {
-        if (thread_h->f() == -1) {
-            thread_m.str = thread_fail_str[thread_h->type];
-            ERROR(thread_fail_str[thread_h->type]);
-            thread_m.line = ERR_LINE;
-            print_info("", INFO_LINE);  // remove previous INFO_LINE message
-        } else {
-            thread_m.str = thread_str[thread_h->type];
-            INFO(thread_str[thread_h->type]);
-            thread_m.line = INFO_LINE;
+static int can_run(const thread_job_list *job) {
+    int busy[MAX_JOB_DEVS] = {0};
+
+    for (thread_job_list *tmp = thread_h; tmp; tmp = tmp->next) {
+        if (!tmp->started) {
+            continue;
+        }
+        if (!job->num_devs || job->num_devs > MAX_JOB_DEVS || !tmp->num_devs || tmp->num_devs > MAX_JOB_DEVS) {
+            return 0;
+        }
+        for (int i = 0; i < job->num_devs; i++) {
+            for (int j = 0; j < tmp->num_devs; j++) {
+                if (job->devs[i] == tmp->devs[j] && ++busy[i] >= config.jobs_per_device) {
+                    return 0;
+                }
+            }
         }
-        free_running_h();
-        print_info(_(thread_m.str), thread_m.line);
+    }
+    return 1;
+}
+
+/*
+ * Returns first queued job that can run, marking it as running,
+ * or NULL if there are none. Queue order is jobs' priority.
+ * Called with job_lck held.
+ */
+static thread_job_list *next_job(void) {
+    for (thread_job_list *tmp = thread_h; tmp; tmp = tmp->next) {
+        if (tmp->state == JOB_QUEUED && can_run(tmp)) {
+            tmp->state = JOB_RUNNING;
+            tmp->started = 1;
+            return tmp;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Removes finished job from the queue, waking up idle workers
+ * as its devices are now free, then notifies user
+ * (telling how its files were copied, if any).
+ */
+static void end_job(thread_job_list *job, int ret) {
+    struct thread_mesg thread_m;
+    const int type = job->type;
+    int cancelled, copied_by[NUM_COPY_METHODS];
+    char mesg[200];
+
+    memcpy(copied_by, job->copied_by, sizeof(copied_by));
+    pthread_mutex_lock(&job_lck);
+    cancelled = job->state == JOB_CANCELLED;
+    job->state = JOB_DONE;
+    remove_job(job);
+    pthread_cond_broadcast(&job_cond);
+    pthread_mutex_unlock(&job_lck);
+    notify_jobs();
+    if (cancelled) {
+        thread_m.str = job_cancel_str;
+        INFO(job_cancel_str);
+        thread_m.line = INFO_LINE;
+    } else if (ret == -1) {
+        thread_m.str = thread_fail_str[type];
+        ERROR(thread_fail_str[type]);
+        thread_m.line = ERR_LINE;
+        print_info("", INFO_LINE);  // remove previous INFO_LINE message
+    } else {
+        thread_m.str = copy_report(_(thread_str[type]), copied_by, mesg, sizeof(mesg));
+        INFO(thread_m.str);
+        thread_m.line = INFO_LINE;
+    }
+    print_info(_(thread_m.str), thread_m.line);
 #ifdef LIBNOTIFY_PRESENT
-        send_notification(_(thread_m.str));
+    send_notification(_(thread_m.str));
 #endif
-        return execute_thread(NULL);
+}
+
+/*
+ * Appends to str how many files were copied by each of copy_methods, eg:
+ * "Every file has been pasted. (10 cloned, 2 read/write)".
+ * Returns str if no file was copied.
+ */
+static const char *copy_report(const char *str, const int *copied_by, char *mesg, size_t size) {
+    int len = snprintf(mesg, size, "%s (", str);
+    const int start = len;
+
+    for (int i = 0; i < NUM_COPY_METHODS && len < (int)size; i++) {
+        if (copied_by[i]) {
+            len += snprintf(mesg + len, size - len, "%s%d %s", len > start ? ", " : "",
+                            copied_by[i], _(copy_method_str[i]));
+        }
     }
-    INFO("ended all queued jobs.");
-    num_of_jobs = 0;
-    current_th = NULL;
-#ifdef SYSTEMD_PRESENT
-    if (config.inhibit) {
-        stop_inhibition(inhibit_fd);
+    if (len == start) {
+        return str;
     }
-#endif
+    if (len < (int)size) {
+        snprintf(mesg + len, size - len, ")");
+    }
+    return mesg;
+}
+
+/*
+ * Worker thread: while job's queue isn't empty, runs first job that can run,
+ * or waits for a running one to end.
+ * When job's queue is empty, it leaves; last worker to leave resets some vars.
+ */
+static void *execute_thread(void *x) {
+    thread_job_list *job;
+
     pthread_detach(pthread_self());
+    pthread_mutex_lock(&job_lck);
+    while (thread_h) {
+        if (!(job = next_job())) {
+            idle_workers++;
+            pthread_cond_wait(&job_cond, &job_lck);
+            idle_workers--;
+            continue;
+        }
+        pthread_mutex_unlock(&job_lck);
+        notify_jobs();
+        current_job = job;
+        scan_job(job);
+        end_job(job, job->f());
+        current_job = NULL;
+        pthread_mutex_lock(&job_lck);
+    }
+    if (!--num_workers) {
+        INFO("ended all queued jobs.");
+        num_of_jobs = 0;
+        current_th = NULL;
+#ifdef SYSTEMD_PRESENT
+        if (config.inhibit) {
+            stop_inhibition(inhibit_fd);
+        }
+#endif
+        pthread_cond_broadcast(&job_cond);
+    }
+    pthread_mutex_unlock(&job_lck);
     pthread_exit(NULL);
 }
+
+/*
+ * Pre-scan phase: totals bytes and files the job will work on,
+ * skipping files that will be left where they are, and counting
+ * as a single file the ones that will just be renamed.
+ * Archives to be extracted are counted by their size.
+ */
+static void scan_job(thread_job_list *job) {
+    char path[PATH_MAX + 1];
+    struct stat sb, dest_sb = {0};
+
+    lstat(job->full_path, &dest_sb);
+    for (int i = 0; i < job->selected_files.num && !job_cancelled(); i++) {
+        const char *str = list_name(&job->selected_files, i);
+
+        strncpy(path, str, PATH_MAX);
+        const char *dir = dirname(path);
+        if (job->type == EXTRACTOR_TH) {
+            if (lstat(str, &sb) == 0) {
+                job->bytes_total += sb.st_size;
+                job->files_total++;
+            }
+        } else if ((job->type == PASTE_TH || job->type == MOVE_TH) && !strcmp(job->full_path, dir)) {
+            continue;
+        } else if (job->type == MOVE_TH && lstat(dir, &sb) == 0 && sb.st_dev == dest_sb.st_dev) {
+            job->files_total++;
+        } else {
+            nftw(str, scan_entry, 64, FTW_MOUNT | FTW_PHYS);
+        }
+    }
+    __atomic_store_n(&job->scanned, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Removals are counted by files only.
+ */
+static int scan_entry(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf) {
+    if (job_cancelled()) {
+        return -1;
+    }
+    current_job->files_total++;
+    if (current_job->type != RM_TH && S_ISREG(sb->st_mode)) {
+        current_job->bytes_total += sb->st_size;
+    }
+    return 0;
+}
+
+/*
+ * Called by worker threads when bytes and files have been done by current job.
+ */
+void job_progress(uint64_t bytes, int files) {
+    if (bytes) {
+        __atomic_add_fetch(&current_job->bytes_done, bytes, __ATOMIC_RELAXED);
+    }
+    if (files) {
+        __atomic_add_fetch(&current_job->files_done, files, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Called by worker threads when current job starts working on path.
+ */
+void job_file(const char *path) {
+    pthread_mutex_lock(&job_lck);
+    strncpy(current_job->current_file, path, PATH_MAX);
+    pthread_mutex_unlock(&job_lck);
+}
+
+/*
+ * Tells main thread that jobs mode tabs and jobs progress need to be updated:
+ * jobs_fd fires now, then every PROGRESS_INTERVAL ms until there are no more jobs.
+ */
+static void notify_jobs(void) {
+    struct itimerspec timerValue = {{0}};
+
+    if (!quit) {
+        timerValue.it_value.tv_nsec = 1;
+        timerValue.it_interval.tv_sec = PROGRESS_INTERVAL / 1000;
+        timerValue.it_interval.tv_nsec = (PROGRESS_INTERVAL % 1000) * 1000000;
+        timerfd_settime(jobs_fd, 0, &timerValue, NULL);
+    }
+}
+
+/*
+ * Updates throughput of every started job, smoothing it
+ * with previous sample, as it is shown for PROGRESS_INTERVAL ms.
+ * A job is sampled again only once it made some progress:
+ * its rate is computed over the whole time since its last sample.
+ * Called with job_lck held.
+ */
+static void sample_jobs(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (thread_job_list *tmp = thread_h; tmp; tmp = tmp->next) {
+        if (!__atomic_load_n(&tmp->scanned, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        uint64_t done = tmp->bytes_total ? __atomic_load_n(&tmp->bytes_done, __ATOMIC_RELAXED)
+                                         : (uint64_t)__atomic_load_n(&tmp->files_done, __ATOMIC_RELAXED);
+        if (tmp->has_sample) {
+            double secs = (now.tv_sec - tmp->sampled_at.tv_sec) + (now.tv_nsec - tmp->sampled_at.tv_nsec) / 1e9;
+            
+            if (done <= tmp->sampled || secs <= 0) {
+                continue;
+            }
+            double rate = (double)(done - tmp->sampled) / secs;
+            tmp->rate = tmp->rate > 0 ? (tmp->rate + rate) / 2 : rate;
+        }
+        tmp->sampled = done;
+        tmp->sampled_at = now;
+        tmp->has_sample = 1;
+    }
+}
+
+/*
+ * Writes job's percentage, throughput (when bytes are counted) and ETA into str.
+ * Called with job_lck held.
+ */
+static void format_progress(const thread_job_list *job, char *str, size_t size) {
+    uint64_t done, total;
+    int len;
+
+    if (!__atomic_load_n(&job->scanned, __ATOMIC_ACQUIRE)) {
+        snprintf(str, size, "%s", _(scanning_job));
+        return;
+    }
+    if (job->bytes_total) {
+        done = __atomic_load_n(&job->bytes_done, __ATOMIC_RELAXED);
+        total = job->bytes_total;
+    } else {
+        done = __atomic_load_n(&job->files_done, __ATOMIC_RELAXED);
+        total = job->files_total;
+    }
+    if (done > total) {
+        done = total;
+    }
+    len = snprintf(str, size, "%d%%", total ? (int)(done * 100 / total) : 100);
+    if (job->bytes_total && job->rate > 0 && len < (int)size) {
+        char rate[20];
+
+        change_unit(job->rate, rate);
+        len += snprintf(str + len, size - len, " %s/s", rate);
+    }
+    if (job->rate > 0 && done < total && len < (int)size) {
+        long eta = (total - done) / job->rate;
+
+        snprintf(str + len, size - len, " ETA %ld:%02ld:%02ld", eta / 3600, (eta / 60) % 60, eta % 60);
+    }
+}
+
+/*
+ * Cancellation checkpoint for worker threads: it waits while current job is paused,
+ * then returns 1 if it has been cancelled.
+ */
+int job_cancelled(void) {
+    int ret;
+
+    if (!current_job || current_job->state == JOB_RUNNING) {
+        return 0;
+    }
+    pthread_mutex_lock(&job_lck);
+    while (current_job->state == JOB_PAUSED) {
+        pthread_cond_wait(&job_cond, &job_lck);
+    }
+    ret = current_job->state == JOB_CANCELLED;
+    pthread_mutex_unlock(&job_lck);
+    return ret;
+}
+
+/*
+ * Prints "[num/num_of_jobs] job type progress" for every started job into str.
+ */
+void jobs_status(char *str, size_t size) {
+    char progress[100];
+    size_t len = strlen(str);
+
+    pthread_mutex_lock(&job_lck);
+    for (thread_job_list *tmp = thread_h; tmp && len < size; tmp = tmp->next) {
+        if (tmp->started) {
+            format_progress(tmp, progress, sizeof(progress));
+            len += snprintf(str + len, size - len, "%s[%d/%d] %s %s", len ? " " : "",
+                            tmp->num, num_of_jobs, _(thread_job_mesg[tmp->type]), progress);
+        }
+    }
+    pthread_mutex_unlock(&job_lck);
+}
+
+int running_workers(void) {
+    int n;
+
+    pthread_mutex_lock(&job_lck);
+    n = num_workers;
+    pthread_mutex_unlock(&job_lck);
+    return n;
+}
+
+/*
+ * Resumes paused jobs, then waits for every worker thread to leave.
+ */
+void wait_job_queue(void) {
+    pthread_mutex_lock(&job_lck);
+    for (thread_job_list *tmp = thread_h; tmp; tmp = tmp->next) {
+        if (tmp->state == JOB_PAUSED) {
+            tmp->state = tmp->started ? JOB_RUNNING : JOB_QUEUED;
+        }
+    }
+    pthread_cond_broadcast(&job_cond);
+    while (num_workers) {
+        pthread_cond_wait(&job_cond, &job_lck);
+    }
+    pthread_mutex_unlock(&job_lck);
+}
+
+/*
+ * Cancels every job: not started ones are removed from the queue,
+ * running ones will leave at their next checkpoint.
+ */
+void cancel_all_jobs(void) {
+    pthread_mutex_lock(&job_lck);
+    for (thread_job_list *tmp = thread_h, *next; tmp; tmp = next) {
+        next = tmp->next;
+        if (tmp->started) {
+            tmp->state = JOB_CANCELLED;
+        } else {
+            remove_job(tmp);
+        }
+    }
+    pthread_cond_broadcast(&job_cond);
+    pthread_mutex_unlock(&job_lck);
+}
+
+/*
+ * Returns link to job numbered num inside job's queue
+ * (its *link is NULL if there is no such job). Called with job_lck held.
+ */
+static thread_job_list **find_job(int num) {
+    thread_job_list **link = &thread_h;
+
+    while (*link && (*link)->num != num) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+/*
+ * Number of the job under the cursor of jobs mode tab.
+ */
+static int viewed_job(void) {
+    return atoi(list_name(&jobs_view, ps[active].curr_pos) + 1);
+}
+
+/*
+ * Fills jobs_view with an entry for each queued job: its num, type,
+ * and file it is working on, or its first file (plus how many other files it will work on).
+ */
+static void update_jobs_view(void) {
+    char str[PATH_MAX + 1];
+
+    free_list(&jobs_view);
+    pthread_mutex_lock(&job_lck);
+    for (thread_job_list *tmp = thread_h; tmp; tmp = tmp->next) {
+        if (strlen(tmp->current_file)) {
+            snprintf(str, sizeof(str), "[%d] %s %s", tmp->num, _(thread_job_mesg[tmp->type]), tmp->current_file);
+            if (add_to_list(&jobs_view, str, DT_UNKNOWN) == -1) {
+                break;
+            }
+            continue;
+        }
+        int len = snprintf(str, sizeof(str), "[%d] %s %s", tmp->num, _(thread_job_mesg[tmp->type]),
+                           tmp->selected_files.num ? list_name(&tmp->selected_files, 0) : "");
+
+        if (tmp->selected_files.num > 1 && len < (int)sizeof(str)) {
+            snprintf(str + len, sizeof(str) - len, " (+%d)", tmp->selected_files.num - 1);
+        }
+        if (add_to_list(&jobs_view, str, DT_UNKNOWN) == -1) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&job_lck);
+}
+
+/*
+ * Switches active tab to jobs mode.
+ */
+void show_jobs(void) {
+    update_jobs_view();
+    if (jobs_view.num) {
+        show_special_tab(jobs_view.num, &jobs_view, jobs_mode_str, jobs_);
+    } else {
+        print_info(_(no_jobs), INFO_LINE);
+    }
+}
+
+/*
+ * Called by main_poll when jobs_fd fires: samples jobs progress,
+ * then updates jobs mode tabs, if any, and jobs status on INFO_LINE.
+ * When there are no more jobs, jobs_fd is disarmed
+ * (no worker can arm it meanwhile, as only main thread starts them).
+ */
+void jobs_refresh(int fd) {
+    struct itimerspec timerValue = {{0}};
+    uint64_t u;
+
+    read(fd, &u, sizeof(u));
+    if (!running_workers()) {
+        timerfd_settime(fd, 0, &timerValue, NULL);
+    }
+    pthread_mutex_lock(&job_lck);
+    sample_jobs();
+    pthread_mutex_unlock(&job_lck);
+    for (int win = 0; win < cont; win++) {
+        if (ps[win].mode == jobs_) {
+            update_jobs_view();
+            redraw_special_mode(jobs_view.num, &jobs_view, jobs_);
+            break;
+        }
+    }
+    refresh_info_line();
+}
+
+/*
+ * Writes i-th viewed job's state, and its progress if it has been started, into str.
+ */
+void show_jobs_stat(int i, char *str) {
+    thread_job_list **link;
+    int len;
+
+    str[0] = '\0';
+    pthread_mutex_lock(&job_lck);
+    link = find_job(atoi(list_name(&jobs_view, i) + 1));
+    if (*link) {
+        len = sprintf(str, "%s", _(job_state_str[(*link)->state]));
+        if ((*link)->started) {
+            str[len++] = ' ';
+            format_progress(*link, str + len, 100 - len);
+        }
+    }
+    pthread_mutex_unlock(&job_lck);
+}
+
+/*
+ * Cancels job under the cursor: if not started, it is removed from the queue.
+ */
+void cancel_viewed_job(void) {
+    thread_job_list **link;
+    int removed = 0;
+
+    pthread_mutex_lock(&job_lck);
+    link = find_job(viewed_job());
+    if (*link) {
+        if ((*link)->started) {
+            (*link)->state = JOB_CANCELLED;
+        } else {
+            remove_job(*link);
+            removed = 1;
+        }
+        pthread_cond_broadcast(&job_cond);
+    }
+    pthread_mutex_unlock(&job_lck);
+    if (removed) {
+        INFO(job_cancel_str);
+        print_info(_(job_cancel_str), INFO_LINE);
+    }
+    update_jobs_view();
+    redraw_special_mode(jobs_view.num, &jobs_view, jobs_);
+}
+
+/*
+ * Pauses job under the cursor, or resumes it if it was paused.
+ */
+void pause_viewed_job(void) {
+    thread_job_list **link;
+
+    pthread_mutex_lock(&job_lck);
+    link = find_job(viewed_job());
+    if (*link) {
+        switch ((*link)->state) {
+        case JOB_QUEUED: case JOB_RUNNING:
+            (*link)->state = JOB_PAUSED;
+            break;
+        case JOB_PAUSED:
+            (*link)->state = (*link)->started ? JOB_RUNNING : JOB_QUEUED;
+            // time spent paused must not lower its rate
+            (*link)->has_sample = 0;
+            pthread_cond_broadcast(&job_cond);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&job_lck);
+    redraw_special_mode(jobs_view.num, &jobs_view, jobs_);
+}
+
+/*
+ * Swaps job under the cursor with next one (down != 0) or previous one,
+ * moving cursor along with it: upper jobs are started first.
+ */
+void move_viewed_job(int down) {
+    thread_job_list **link, **prev = NULL, *job;
+    int num = viewed_job(), moved = 0;
+
+    pthread_mutex_lock(&job_lck);
+    for (link = &thread_h; *link && (*link)->num != num; link = &(*link)->next) {
+        prev = link;
+    }
+    if (*link && !down && prev) {
+        // moving job up is moving previous one down
+        link = prev;
+    }
+    if (*link && (*link)->next && (down || prev)) {
+        job = *link;
+        *link = job->next;
+        job->next = (*link)->next;
+        (*link)->next = job;
+        if (current_th == *link) {
+            current_th = job;
+        }
+        moved = 1;
+    }
+    pthread_mutex_unlock(&job_lck);
+    if (moved) {
+        update_jobs_view();
+        redraw_special_mode(jobs_view.num, &jobs_view, jobs_);
+        move_cursor(active, ps[active].curr_pos + (down ? 1 : -1));
+    }
+}
+
+void free_jobs_view(void) {
+    free_list(&jobs_view);
+}